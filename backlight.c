@@ -1,55 +1,213 @@
-#include "backlight.h"
-
 #define _POSIX_SOURCE
 #define _DEFAULT_SOURCE
 
+#include "backlight.h"
+
 #include <unistd.h>
 #include <dirent.h>
 #include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/types.h>
 #include <linux/limits.h>
 #include <fcntl.h>
 
 #include "log.h"
 
-int open_brightness_file(int *max_bright)
+/* ms between fade steps */
+#define FADE_STEP 20
+
+/* the order userspace should prefer backlight types in, see sysfs-class-backlight */
+static const char *const type_preference[] = { "firmware", "platform", "raw" };
+
+#define TYPE_COUNT (sizeof(type_preference) / sizeof(type_preference[0]))
+
+static int read_int_file(const char *path, int *value)
+{
+    char buf[32];
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return -1;
+    ssize_t len = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    if (len <= 0)
+        return -1;
+    buf[len] = '\0';
+    *value = atoi(buf);
+    return 0;
+}
+
+/* lower is better, unknown types rank after all known ones */
+static unsigned int type_rank(const char *class_path, const char *name)
+{
+    char path[PATH_MAX];
+    char buf[32];
+
+    snprintf(path, PATH_MAX, "%s%s%s", class_path, name, BACKLIGHT_TYPE_FILE);
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return TYPE_COUNT;
+    ssize_t len = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    if (len <= 0)
+        return TYPE_COUNT;
+    buf[len] = '\0';
+    buf[strcspn(buf, "\n")] = '\0';
+
+    for (unsigned int i = 0; i < TYPE_COUNT; ++i) {
+        if (strcmp(buf, type_preference[i]) == 0)
+            return i;
+    }
+    return TYPE_COUNT;
+}
+
+/* readdir order is arbitrary, rank every device so the choice is the same each boot */
+static bool pick_device(const char *class_path, char *name)
 {
     DIR *dir;
     struct dirent *entry;
+    unsigned int best_rank = TYPE_COUNT + 1;
 
-    if ((dir = opendir(BACKLIGHT_SYSFS_PATH)) == NULL) {
-        ERROR("Can not open dir %s", BACKLIGHT_SYSFS_PATH);
-        return -1;
+    if ((dir = opendir(class_path)) == NULL) {
+        ERROR("Can not open dir %s", class_path);
+        return false;
+    }
+
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] == '.')
+            continue;
+        unsigned int rank = type_rank(class_path, entry->d_name);
+        if (rank < best_rank || (rank == best_rank && strcmp(entry->d_name, name) < 0)) {
+            best_rank = rank;
+            snprintf(name, NAME_MAX + 1, "%s", entry->d_name);
+        }
     }
+    closedir(dir);
+
+    return best_rank <= TYPE_COUNT;
+}
 
-    seekdir(dir, 2);
-    entry = readdir(dir);
+static void write_brightness(struct backlight *bl, int value)
+{
+    char buf[16];
 
-    if(entry == NULL) {
+    if (value == bl->current)
+        return;
+
+    int len = snprintf(buf, sizeof(buf), "%i", value);
+    if (pwrite(bl->fd, buf, len, 0) != len) {
+        ERROR("could not set brightness of %s", bl->name);
+        bl->current = -1;
+        return;
+    }
+    bl->current = value;
+}
+
+static void on_fade_timer(int fd, uint32_t events, void *data)
+{
+    struct backlight *bl = data;
+
+    bl->fade_step += timer_ack(fd);
+    /* cancelled after the timer became readable */
+    if (!bl->fade_steps)
+        return;
+    if (bl->fade_step >= bl->fade_steps) {
+        timer_arm(fd, 0, false);
+        bl->fade_steps = 0;
+        write_brightness(bl, bl->fade_to);
+        return;
+    }
+    write_brightness(bl, bl->fade_from
+        + (bl->fade_to - bl->fade_from) * (int)bl->fade_step / (int)bl->fade_steps);
+}
+
+int backlight_open(struct backlight *bl, const char *sysfs_root, const char *name,
+    struct event_loop *loop)
+{
+    char class_path[PATH_MAX];
+    char path[PATH_MAX];
+
+    memset(bl, 0, sizeof(*bl));
+    bl->fd = -1;
+    bl->current = -1;
+    bl->fade_timer = -1;
+
+    snprintf(class_path, PATH_MAX, "%s%s", sysfs_root, BACKLIGHT_CLASS_PATH);
+    if (name) {
+        snprintf(bl->name, sizeof(bl->name), "%s", name);
+    } else if (!pick_device(class_path, bl->name)) {
         ERROR("No backlight available");
-        closedir(dir);
         return -1;
     }
 
-    char buf[PATH_MAX];
-    snprintf(buf, PATH_MAX, "%s%s%s", BACKLIGHT_SYSFS_PATH, entry->d_name, BACKLIGHT_MAX_BRIGHTNESS_FILE);
-    int max_bright_fd = open(buf, O_RDONLY);
-    if (max_bright_fd < 0) {
-        ERROR("No max_brightness available at %s", buf);
-        closedir(dir);
+    snprintf(path, PATH_MAX, "%s%s%s", class_path, bl->name, BACKLIGHT_MAX_BRIGHTNESS_FILE);
+    if (read_int_file(path, &bl->max) < 0 || bl->max <= 0) {
+        ERROR("could not read max_brightness of %s", bl->name);
         return -1;
     }
-    if(read(max_bright_fd, buf, PATH_MAX) <= 0 || (*max_bright = atoi(buf)) == 0) {
-        ERROR("could not read max_brightness");
-        close(max_bright_fd);
+
+    snprintf(path, PATH_MAX, "%s%s%s", class_path, bl->name, BACKLIGHT_BRIGHTNESS_FILE);
+    if (read_int_file(path, &bl->current) < 0)
+        bl->current = -1;
+    bl->fd = open(path, O_WRONLY | O_CLOEXEC);
+    if (bl->fd < 0) {
+        ERROR("could not open %s", path);
         return -1;
     }
-    close(max_bright_fd);
 
-    snprintf(buf, PATH_MAX, "%s%s%s", BACKLIGHT_SYSFS_PATH, entry->d_name, BACKLIGHT_BRIGHTNESS_FILE);
+    /* without a timer fades just jump to their end */
+    bl->fade_timer = timer_new();
+    if (bl->fade_timer >= 0 && event_loop_add(loop, bl->fade_timer, on_fade_timer, bl) < 0) {
+        close(bl->fade_timer);
+        bl->fade_timer = -1;
+    }
 
-    closedir(dir);
+    LOG("INFO", "using backlight %s, max brightness %i", bl->name, bl->max);
+    return 0;
+}
 
-    return open(buf, O_WRONLY);
+void backlight_set(struct backlight *bl, int value)
+{
+    if (bl->fd < 0)
+        return;
+    if (bl->fade_timer >= 0)
+        timer_arm(bl->fade_timer, 0, false);
+    bl->fade_steps = 0;
+    write_brightness(bl, value);
+}
+
+void backlight_fade(struct backlight *bl, int value, unsigned int ms)
+{
+    if (bl->fd < 0)
+        return;
+    if (bl->fade_timer < 0 || bl->current < 0 || bl->current == value || ms < FADE_STEP) {
+        backlight_set(bl, value);
+        return;
+    }
+
+    bl->fade_from = bl->current;
+    bl->fade_to = value;
+    bl->fade_step = 0;
+    bl->fade_steps = ms / FADE_STEP;
+    timer_arm(bl->fade_timer, FADE_STEP, true);
+}
+
+bool backlight_fading(const struct backlight *bl)
+{
+    return bl->fade_steps != 0;
+}
+
+void backlight_close(struct backlight *bl, struct event_loop *loop)
+{
+    if (bl->fade_timer >= 0) {
+        event_loop_remove(loop, bl->fade_timer);
+        close(bl->fade_timer);
+        bl->fade_timer = -1;
+    }
+    if (bl->fd >= 0) {
+        close(bl->fd);
+        bl->fd = -1;
+    }
 }
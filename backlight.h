@@ -1,7 +1,59 @@
 #pragma once
 
-#define BACKLIGHT_SYSFS_PATH			"/sys/class/backlight/"
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "eventloop.h"
+
+#define BACKLIGHT_CLASS_PATH			"/class/backlight/"
 #define BACKLIGHT_BRIGHTNESS_FILE		"/brightness"
 #define BACKLIGHT_MAX_BRIGHTNESS_FILE		"/max_brightness"
+#define BACKLIGHT_TYPE_FILE			"/type"
+
+/**
+  A backlight device and what was last written to it. Writes of the value it
+  already has are skipped, and fades step on a timer in the event loop.
+*/
+struct backlight {
+    char name[NAME_MAX + 1];
+    int fd; /* brightness, -1 without a backlight */
+    int max;
+    int current; /* last written value, -1 if not known */
+    int fade_timer;
+    int fade_from;
+    int fade_to;
+    unsigned int fade_steps; /* 0 when not fading */
+    unsigned int fade_step;
+};
+
+/**
+  open a backlight below sysfs_root, firmware interfaces are preferred over
+  platform ones and those over raw ones, ties go to the first name
+  @param sysfs_root where sysfs is mounted, usually /sys
+  @param name the device to use, NULL to pick one
+  @param loop runs the fades
+  @returns 0 on success, -1 if there is no usable backlight, fd is -1 then
+*/
+int backlight_open(struct backlight *bl, const char *sysfs_root, const char *name,
+    struct event_loop *loop);
+
+/**
+  set the brightness now, stops a running fade
+*/
+void backlight_set(struct backlight *bl, int value);
+
+/**
+  go to a brightness in steps over ms milliseconds, without blocking
+*/
+void backlight_fade(struct backlight *bl, int value, unsigned int ms);
+
+/**
+  @returns true while a fade is running
+*/
+bool backlight_fading(const struct backlight *bl);
 
-int open_brightness_file(int *max_bright);
+/**
+  stop fading and close the device, the brightness is left as it is
+*/
+void backlight_close(struct backlight *bl, struct event_loop *loop);
@@ -10,6 +10,7 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <strings.h>
 #include <stdlib.h>
 #include <alloca.h>
 #include <math.h>
@@ -19,9 +20,13 @@
 #include <stdbool.h>
 #include <dirent.h>
 #include <unistd.h>
+#include <time.h>
+#include <limits.h>
+#include <linux/limits.h>
 
 #include "battery.h"
 #include "log.h"
+#include "ocv_table.h"
 
 #define max(a, b) \
   ({ __typeof__ (a) _a = (a); \
@@ -33,7 +38,186 @@
      __typeof__ (b) _b = (b);  \
      _a < _b ? _a : _b; })
 
-static const char *sys_class_power_supply_path = "/sys/class/power_supply";
+#define POWER_SUPPLY_CLASS "/class/power_supply"
+
+static char sys_class_power_supply_path[PATH_MAX] = "/sys" POWER_SUPPLY_CLASS;
+
+/* attributes we keep open for every node we care about */
+enum power_attr {
+	ATTR_PRESENT,
+	ATTR_STATUS,
+	ATTR_CAPACITY,
+	ATTR_VOLTAGE_NOW,
+	ATTR_CURRENT_NOW,
+	ATTR_TEMP,
+	ATTR_TIME_TO_EMPTY_NOW,
+	ATTR_TIME_TO_FULL_NOW,
+	ATTR_ENERGY_NOW,
+	ATTR_ENERGY_FULL,
+	ATTR_CHARGE_NOW,
+	ATTR_CHARGE_FULL,
+	ATTR_ONLINE,
+	ATTR_MAX,
+};
+
+static bool int_string(char *str, int *val);
+
+static const char *const power_attr_names[ATTR_MAX] = {
+	[ATTR_PRESENT] = "present",
+	[ATTR_STATUS] = "status",
+	[ATTR_CAPACITY] = "capacity",
+	[ATTR_VOLTAGE_NOW] = "voltage_now",
+	[ATTR_CURRENT_NOW] = "current_now",
+	[ATTR_TEMP] = "temp",
+	[ATTR_TIME_TO_EMPTY_NOW] = "time_to_empty_now",
+	[ATTR_TIME_TO_FULL_NOW] = "time_to_full_now",
+	[ATTR_ENERGY_NOW] = "energy_now",
+	[ATTR_ENERGY_FULL] = "energy_full",
+	[ATTR_CHARGE_NOW] = "charge_now",
+	[ATTR_CHARGE_FULL] = "charge_full",
+	[ATTR_ONLINE] = "online",
+};
+
+#define ATTR_BIT(a) (1u << (a))
+
+/* what adds up the charge of several batteries */
+#define AGGREGATE_ATTRS (ATTR_BIT(ATTR_ENERGY_NOW) | ATTR_BIT(ATTR_ENERGY_FULL) | \
+                         ATTR_BIT(ATTR_CHARGE_NOW) | ATTR_BIT(ATTR_CHARGE_FULL))
+
+/* the attributes a battery_info field is computed from */
+static const unsigned int field_attrs[] = {
+	[0] = ATTR_BIT(ATTR_CAPACITY),                          /* BATTERY_FRACTION */
+	[1] = ATTR_BIT(ATTR_TIME_TO_EMPTY_NOW),                 /* BATTERY_SECONDS */
+	[2] = ATTR_BIT(ATTR_PRESENT) | ATTR_BIT(ATTR_STATUS),   /* BATTERY_STATE */
+	[3] = ATTR_BIT(ATTR_VOLTAGE_NOW),                       /* BATTERY_VOLTAGE */
+	[4] = ATTR_BIT(ATTR_CURRENT_NOW),                       /* BATTERY_CURRENT */
+	[5] = ATTR_BIT(ATTR_TEMP),                              /* BATTERY_TEMPERATURE */
+	[6] = ATTR_BIT(ATTR_ONLINE),                            /* BATTERY_SOURCE */
+	[7] = ATTR_BIT(ATTR_TIME_TO_FULL_NOW) | ATTR_BIT(ATTR_STATUS) |
+	      ATTR_BIT(ATTR_CURRENT_NOW) | ATTR_BIT(ATTR_VOLTAGE_NOW) |
+	      AGGREGATE_ATTRS,                                  /* BATTERY_SECONDS_TO_FULL */
+};
+
+/* what battery_estimate needs when a gauge has no capacity */
+#define ESTIMATE_ATTRS (ATTR_BIT(ATTR_VOLTAGE_NOW) | ATTR_BIT(ATTR_CURRENT_NOW))
+
+/* numeric attribute we have no value for */
+#define NO_VALUE INT_MIN
+
+/* series resistance (in mOhm) assumed until we learned better, and the range
+   we believe */
+#define RESISTANCE_DEFAULT 150
+#define RESISTANCE_MIN 20
+#define RESISTANCE_MAX 1000
+/* smallest current change (in mA) to learn the resistance from */
+#define RESISTANCE_MIN_STEP 50
+/* new samples count 1 / RESISTANCE_WEIGHT */
+#define RESISTANCE_WEIGHT 8
+
+/* voltage_max_design (in uV) from which on Li-ion is the high voltage kind */
+#define LIHV_MIN_VOLTAGE 4300000
+
+/* how fast (in ms) the charge filter follows the voltage model; the
+   coulomb count carries it in between */
+#define SOC_FILTER_TAU 300000
+/* nominal cell voltage (in mV) to turn an energy into a charge */
+#define NOMINAL_VOLTAGE 3700
+/* how old (in seconds) a saved charge may be to start from it */
+#define SOC_STATE_MAX_AGE 600
+
+/* batteries whose learned state we keep */
+#define MAX_SAVED_BATTERIES 16
+/* power_supply nodes room is made for at first, grows as needed */
+#define POWER_NODES_INITIAL 8
+
+/* how often (in seconds) we list the directory to notice new nodes */
+#define RESCAN_INTERVAL 10
+
+/* what we last learned about a supply */
+struct supply_state {
+	enum battery_state state;
+	int val[ATTR_MAX]; /* numeric attributes, NO_VALUE if unknown */
+};
+
+struct resistance {
+	int mV, mA; /* last sample */
+	bool valid;
+	int mOhm;
+};
+
+/*
+ * State of charge of a battery without capacity attribute: the current is
+ * integrated over time and the result pulled towards the voltage model, so
+ * load changes don't make it jump.
+ */
+struct soc_filter {
+	bool valid;
+	int ppm; /* state of charge, 1000000 == 100% */
+	long long time; /* CLOCK_MONOTONIC ms of ppm */
+	int mAh; /* design capacity, 0 if unknown; then we only smooth */
+};
+
+struct power_node {
+	char name[64];
+	enum power_state type;
+	enum ocv_chemistry chemistry;
+	struct resistance resistance;
+	struct soc_filter filter;
+	int uevent_fd;
+	int fd[ATTR_MAX];
+	unsigned int offered; /* ATTR_BITs of the files the driver has */
+	struct supply_state st;
+};
+
+/* attribute values of one node, pointing into buf, newlines stripped */
+struct power_values {
+	char buf[4096];
+	size_t used;
+	unsigned int tried; /* ATTR_BITs already read, or all after a uevent */
+	const char *val[ATTR_MAX];
+};
+
+static enum battery_backend backend = BATTERY_BACKEND_AUTO;
+
+/* chemistry of all batteries, OCV_CHEMISTRIES to go by what they report */
+static enum ocv_chemistry chemistry = OCV_CHEMISTRIES;
+
+/* what was learned about the batteries, kept over cache rebuilds and, in
+   state_file, over restarts */
+struct battery_state_saved {
+	char name[64];
+	int ppm; /* -1 if the filter never ran */
+	int mOhm;
+	time_t time; /* CLOCK_REALTIME seconds */
+};
+
+static struct {
+	struct battery_state_saved node[MAX_SAVED_BATTERIES];
+	int count;
+} saved;
+
+static char state_file[PATH_MAX];
+
+/*
+ * The set of power_supply nodes is static on almost every device, so we
+ * classify them once, keep their attribute files open and only pread() them
+ * afterwards.  The cache is rebuilt when a node vanishes (a read fails and
+ * the node is gone) or when the directory listing changes.  Every node keeps
+ * the values last read from it, so a uevent only needs to update its own
+ * node and battery_info is computed from all of them.  Supplies that don't
+ * power the system are only remembered by name, so their uevents don't look
+ * like news.
+ */
+static struct {
+	struct power_node *node;
+	int count, size;
+	char (*ignored)[64];
+	int ignored_count, ignored_size;
+	int batteries; /* batteries among the nodes */
+	bool valid;
+	unsigned long listing; /* hash of the directory listing at build time */
+	time_t checked;
+} cache;
 
 static int
 open_power_file(const char *base, const char *node, const char *key)
@@ -45,7 +229,7 @@ open_power_file(const char *base, const char *node, const char *key)
 	}
 
 	snprintf(path, pathlen, "%s/%s/%s", base, node, key);
-	return open(path, O_RDONLY);
+	return open(path, O_RDONLY | O_CLOEXEC);
 }
 
 static bool
@@ -67,116 +251,435 @@ read_power_file(const char *base, const char *node, const char *key,
 }
 
 static bool
-int_string(char *str, int *val)
+power_node_exists(const char *base, const char *node)
 {
-	char *endptr = NULL;
-	*val = (int) strtol(str, &endptr, 0);
-	return ((*str != '\0') && (*endptr == '\0'));
+	char path[PATH_MAX];
+
+	snprintf(path, sizeof (path), "%s/%s", base, node);
+	return access(path, F_OK) == 0;
 }
 
-/* calculate remaining fuel level (in %) of a LiIon battery assuming
- * a standard chemistry model
- *    The first reference found on the web seems to be a forum post
- *    by "SilverFox" from 04-16-2008. It appears to be attributed to Sanyo.
- *    http://www.candlepowerforums.com/vb/showthread.php?115871-Li-Ion-State-of-Charge-and-Voltage-Measurements#post2440539
- *
- * @mV: voltage measured outside the battery
- * @mA: current flowing out of the battery
- * @mOhm: assumed series resitance of the battery
- *
- * returns value between 0 and 100
+static bool
+read_node_attr(struct power_node *n, enum power_attr attr,
+               char *buf, size_t buflen)
+{
+	ssize_t br;
+
+	if (n->fd[attr] == -1) {
+		return false;  /* driver doesn't offer this one. */
+	}
+	br = pread(n->fd[attr], buf, buflen-1, 0);
+	if (br < 0) {
+		/* gauges report transient errors too, only a missing node
+		   means our view of the directory is out of date. */
+		if (!power_node_exists(sys_class_power_supply_path, n->name))
+			cache.valid = false;
+		return false;
+	}
+	buf[br] = '\0';
+	return true;
+}
+
+static void
+values_reset(struct power_values *v)
+{
+	v->used = 0;
+	v->tried = 0;
+	for (int a = 0; a < ATTR_MAX; a++)
+		v->val[a] = NULL;
+}
+
+/* one file per attribute, as the class documents them; only the attributes
+   in attrs that were not read yet, so this can be called again for more */
+static void
+read_node_files(struct power_node *n, struct power_values *v, unsigned int attrs)
+{
+	attrs &= ~v->tried;
+	v->tried |= attrs;
+
+	for (int a = 0; a < ATTR_MAX; a++) {
+		char *str = v->buf + v->used;
+		size_t len;
+
+		if (!(attrs & ATTR_BIT(a)))
+			continue;
+		if (sizeof (v->buf) - v->used < 2 ||
+		    !read_node_attr(n, a, str, sizeof (v->buf) - v->used)) {
+			continue;
+		}
+		len = strcspn(str, "\n");
+		str[len] = '\0';
+		v->val[a] = str;
+		v->used += len + 1;
+	}
+}
+
+/*
+ * Split a power_supply uevent ("POWER_SUPPLY_CAPACITY=87\n...") in place
+ * and point the attributes we know about at their values.  The uevent file
+ * separates lines with sep = '\n', netlink messages with '\0'.
  */
-static inline int fuel_level_LiIon(int mV, int mA, int mOhm)
+static void
+parse_uevent(char *buf, size_t len, char sep, struct power_values *v)
 {
-	int u;
+	static const char prefix[] = "POWER_SUPPLY_";
+	char *line = buf;
+	char *end = buf + len;
 
-	/* internal battery voltage is higher than measured when discharging */
-	mV += (mOhm * mA) /1000;
+	values_reset(v);
+	v->tried = ~0u;
+
+	while (line < end) {
+		char *eol = memchr(line, sep, end - line);
+		char *eq;
 
-	/* apply first part of formula */
-	u = 3870000 - (14523 * (37835 - 10 * mV));
+		if (!eol)
+			eol = end;
+		*eol = '\0';
 
-	/* use linear approx. below 3.756V => 50.00% assuming 3.3V => 0% */
-	if (u < 0) {
-		int a = (((mV - 3300)*1000) / 456) * 5000;
-		return max(a / 100000, 0);
+		eq = memchr(line, '=', eol - line);
+		if (eq && strncmp(line, prefix, sizeof (prefix) - 1) == 0) {
+			const char *key = line + sizeof (prefix) - 1;
+			const size_t keylen = eq - key;
+
+			for (int a = 0; a < ATTR_MAX; a++) {
+				if (strlen(power_attr_names[a]) == keylen &&
+				    strncasecmp(key, power_attr_names[a], keylen) == 0) {
+					v->val[a] = eq + 1;
+					break;
+				}
+			}
+		}
+		line = eol + 1;
 	}
+}
+
+static bool
+read_node_uevent(struct power_node *n, struct power_values *v)
+{
+	ssize_t br;
 
-	/* apply second part of formula **/
-	int percent = min((int)(1966 + sqrt(u))/100, 100);
-    if (percent < 0)
-		percent = 0;
-    else if (percent > 100)
-		percent = 100;
-	return percent;
+	if (n->uevent_fd == -1) {
+		return false;
+	}
+	br = pread(n->uevent_fd, v->buf, sizeof (v->buf) - 1, 0);
+	if (br <= 0) {
+		if (br < 0 && !power_node_exists(sys_class_power_supply_path, n->name))
+			cache.valid = false;
+		return false;
+	}
+	v->buf[br] = '\0';
+	parse_uevent(v->buf, br, '\n', v);
+	return true;
 }
 
-double battery_estimate(struct battery_info *i)
+/*
+ * Fetch the attributes in attrs of a node.  The uevent file gives us
+ * everything in a single read, but the driver queries the gauge for every
+ * property to produce it.  So unless told otherwise we only use it when all
+ * the attributes the driver has are wanted anyway, and read file by file
+ * otherwise (or when the uevent can not be read).
+ */
+static void
+read_node(struct power_node *n, struct power_values *v, unsigned int attrs)
 {
-	int mA = 100;
-	int mV = i->voltage * 1000;
+	/* only needed with several batteries, they don't count */
+	const unsigned int offered = n->offered & ~AGGREGATE_ATTRS;
+	const bool all = (attrs & offered) == offered;
+
+	values_reset(v);
+	if ((backend == BATTERY_BACKEND_UEVENT ||
+	     (backend == BATTERY_BACKEND_AUTO && all)) &&
+	    read_node_uevent(n, v)) {
+		return;
+	}
+	if (backend == BATTERY_BACKEND_UEVENT && n->uevent_fd != -1) {
+		values_reset(v);
+		return;
+	}
+	read_node_files(n, v, attrs);
+}
 
-	if (!isnan(i->current))
-		mA = i->current * 1000;
+/* djb2 over all entry names, cheap way to notice added or removed nodes */
+static bool
+hash_listing(const char *base, unsigned long *hash)
+{
+	struct dirent *dent;
+	DIR *dirp;
+	unsigned long h = 5381;
 
-	LOG("INFO", "Running SOC estimation for %dmV and %dmA", mV, mA);
-	return fuel_level_LiIon(mV, mA, 150) / 100.;
+	dirp = opendir(base);
+	if (!dirp) {
+		return false;
+	}
+	while ((dent = readdir(dirp)) != NULL) {
+		for (const char *c = dent->d_name; *c; c++)
+			h = h * 33 + (unsigned char) *c;
+		h = h * 33 + '/';
+	}
+	closedir(dirp);
+	*hash = h;
+	return true;
 }
 
-bool
-battery_fill_info(struct battery_info *i)
+static void
+state_stash(void)
+{
+	saved.count = 0;
+	for (int idx = 0; idx < cache.count; idx++) {
+		const struct power_node *n = &cache.node[idx];
+		struct battery_state_saved *s = &saved.node[saved.count];
+
+		if (n->type != BATTERY)
+			continue;
+		if (saved.count == MAX_SAVED_BATTERIES)
+			break;
+		strcpy(s->name, n->name);
+		s->ppm = n->filter.valid ? n->filter.ppm : -1;
+		s->mOhm = n->resistance.mOhm;
+		s->time = time(NULL);
+		saved.count++;
+	}
+}
+
+static void
+state_restore(struct power_node *n)
+{
+	const time_t now = time(NULL);
+	struct timespec ts;
+
+	for (int idx = 0; idx < saved.count; idx++) {
+		const struct battery_state_saved *s = &saved.node[idx];
+
+		if (strcmp(s->name, n->name) != 0)
+			continue;
+		n->resistance.mOhm = s->mOhm;
+		/* a charger could have come and gone while nobody was watching */
+		if (s->ppm >= 0 && now >= s->time && now - s->time <= SOC_STATE_MAX_AGE) {
+			clock_gettime(CLOCK_MONOTONIC, &ts);
+			n->filter.valid = true;
+			n->filter.ppm = s->ppm;
+			n->filter.time = ts.tv_sec * 1000LL + ts.tv_nsec / 1000000;
+		}
+		return;
+	}
+}
+
+static void
+state_load(void)
+{
+	FILE *f = fopen(state_file, "r");
+	struct battery_state_saved *s;
+	long long t;
+
+	saved.count = 0;
+	if (!f) {
+		return;
+	}
+	while (saved.count < MAX_SAVED_BATTERIES) {
+		s = &saved.node[saved.count];
+		if (fscanf(f, "%63s %d %d %lld", s->name, &s->ppm, &s->mOhm, &t) != 4)
+			break;
+		if (s->mOhm < RESISTANCE_MIN || s->mOhm > RESISTANCE_MAX || s->ppm > 1000000)
+			continue;
+		s->time = t;
+		saved.count++;
+	}
+	fclose(f);
+}
+
+static void
+state_save(void)
+{
+	char tmp[PATH_MAX + 4];
+	FILE *f;
+
+	snprintf(tmp, sizeof (tmp), "%s.new", state_file);
+	f = fopen(tmp, "w");
+	if (!f) {
+		LOG("WARN", "can not save battery state to %s", state_file);
+		return;
+	}
+	for (int idx = 0; idx < saved.count; idx++) {
+		const struct battery_state_saved *s = &saved.node[idx];
+		fprintf(f, "%s %d %d %lld\n", s->name, s->ppm, s->mOhm, (long long) s->time);
+	}
+	if (fclose(f) != 0 || rename(tmp, state_file) != 0) {
+		LOG("WARN", "can not save battery state to %s", state_file);
+		unlink(tmp);
+	}
+}
+
+static void
+cache_clear(void)
+{
+	if (cache.count)
+		state_stash();
+
+	for (int n = 0; n < cache.count; n++) {
+		if (cache.node[n].uevent_fd != -1)
+			close(cache.node[n].uevent_fd);
+		for (int a = 0; a < ATTR_MAX; a++) {
+			if (cache.node[n].fd[a] != -1)
+				close(cache.node[n].fd[a]);
+		}
+	}
+	cache.count = 0;
+	cache.ignored_count = 0;
+	cache.batteries = 0;
+	cache.valid = false;
+}
+
+static enum power_state
+supply_type(const char *str)
+{
+	static const struct {
+		const char *name;
+		enum power_state type;
+	} types[] = {
+		{ "Battery", BATTERY },
+		{ "USB", USB },
+		/* before usb_type, the kind of port was reported as the type */
+		{ "USB_DCP", USB },
+		{ "USB_CDP", USB },
+		{ "USB_ACA", USB },
+		{ "USB_C", USB },
+		{ "USB_PD", USB },
+		{ "USB_PD_DRP", USB },
+		{ "BrickID", USB },
+		{ "Mains", MAINS },
+		{ "Wireless", WIRELESS },
+	};
+	const size_t len = strcspn(str, "\n");
+
+	for (size_t t = 0; t < sizeof (types) / sizeof (types[0]); t++) {
+		if (strlen(types[t].name) == len &&
+		    strncmp(str, types[t].name, len) == 0)
+			return types[t].type;
+	}
+	return UNKOWN;
+}
+
+/* which OCV curve fits a battery, for estimating a missing capacity */
+static enum ocv_chemistry
+battery_chemistry(const char *base, const char *name)
+{
+	char str[64];
+	int uV;
+
+	if (chemistry != OCV_CHEMISTRIES)
+		return chemistry;
+
+	if (read_power_file(base, name, "technology", str, sizeof (str)) &&
+	    strcmp(str, "LiFe\n") == 0) {
+		return OCV_LIFEPO4;
+	}
+	if (read_power_file(base, name, "voltage_max_design", str, sizeof (str))) {
+		str[strcspn(str, "\n")] = '\0';
+		if (int_string(str, &uV) && uV >= LIHV_MIN_VOLTAGE)
+			return OCV_LIHV;
+	}
+	return OCV_LIION;
+}
+
+/* capacity (in mAh) the charge filter counts against, 0 if unknown */
+static int
+battery_design_capacity(const char *base, const char *name)
+{
+	static const struct {
+		const char *attr;
+		int divisor; /* to mAh */
+	} sources[] = {
+		{ "charge_full_design", 1000 },
+		{ "charge_full", 1000 },
+		{ "energy_full_design", NOMINAL_VOLTAGE },
+		{ "energy_full", NOMINAL_VOLTAGE },
+	};
+	char str[64];
+	int val;
+
+	for (size_t s = 0; s < sizeof (sources) / sizeof (sources[0]); s++) {
+		if (!read_power_file(base, name, sources[s].attr, str, sizeof (str)))
+			continue;
+		str[strcspn(str, "\n")] = '\0';
+		if (int_string(str, &val) && val > 0)
+			return val / sources[s].divisor;
+	}
+	return 0;
+}
+
+static bool
+is_input(enum power_state type)
+{
+	return type == USB || type == MAINS || type == WIRELESS;
+}
+
+/* makes room for one more element in an array of *size, false if out of
+   memory */
+static bool
+grow(void **array, int *size, int count, size_t element)
+{
+	void *bigger;
+	int want;
+
+	if (count < *size)
+		return true;
+	want = *size ? *size * 2 : POWER_NODES_INITIAL;
+	bigger = realloc(*array, want * element);
+	if (!bigger)
+		return false;
+	*array = bigger;
+	*size = want;
+	return true;
+}
+
+static bool
+cache_build(void)
 {
 	const char *base = sys_class_power_supply_path;
 	struct dirent *dent;
+	struct timespec now;
 	DIR *dirp;
 
+	cache_clear();
+
+	if (!hash_listing(base, &cache.listing)) {
+		return false;
+	}
 	dirp = opendir(base);
 	if (!dirp) {
 		return false;
 	}
 
-	/* assume we're just plugged in. */
-	i->state = NO_BATTERY;
-	i->seconds = NAN;
-	i->fraction = NAN;
-	i->voltage = NAN;
-	i->current = NAN;
-	i->temperature = NAN;
-	i->source = UNKOWN;
-
 	while ((dent = readdir(dirp)) != NULL) {
 		const char *name = dent->d_name;
-		bool choose = false;
+		struct power_node *n;
+		enum power_state type;
+		bool system = true;
 		char str[64];
-		enum battery_state st;
-		int secs = -1;
-		int pct = -1;
-		int vlt = -1;
-		int cur = -999999999;
-		int temp = -999999999;
-		enum power_state type = UNKOWN;
 
 		if ((strcmp(name, ".") == 0) || (strcmp(name, "..") == 0)) {
 			continue;  /* skip these, of course. */
 		}
 
-		if (!strcmp(name, "rx51-battery")) {
-		  /* Nokia N900 has rx51-battery and bq27200-0; both have type=Battery,
-		     and unfortunately both refer to same battery.
-		  */
+		if (strlen(name) >= sizeof (n->name)) {
+			LOG("WARN", "Dropping power supply %s, the name is too long", name);
 			continue;
 		}
 
 		if (!read_power_file(base, name, "type", str, sizeof (str))) {
 			continue;  /* Don't know _what_ we're looking at. Give up on it. */
 		}
-		if (strcmp(str, "Battery\n") == 0)
-			type = BATTERY;
-		else if (strcmp(str, "USB\n") == 0 )
-			type = USB;
+		type = supply_type(str);
 		if (type == UNKOWN)
 			continue;
 
+		if (!strcmp(name, "rx51-battery")) {
+		  /* Nokia N900 has rx51-battery and bq27200-0; both have type=Battery,
+		     and unfortunately both refer to same battery.
+		  */
+			system = false;
+		}
 
 		/* if the scope is "device," it might be something like a PS4
 		   controller reporting its own battery, and not something that powers
@@ -184,105 +687,610 @@ battery_fill_info(struct battery_info *i)
 		   assume it's a system battery if not specified. */
 		if (read_power_file(base, name, "scope", str, sizeof (str))) {
 			if (strcmp(str, "device\n") == 0) {
-				continue;  /* skip external devices with their own batteries. */
+				system = false;  /* skip external devices with their own batteries. */
 			}
 		}
 
-		if(type == BATTERY) {
-			/* some drivers don't offer this, so if it's not explicitly reported assume it's present. */
-			if (read_power_file(base, name, "present", str, sizeof (str)) && (strcmp(str, "0\n") == 0)) {
-				st = NO_BATTERY;
-			} else if (!read_power_file(base, name, "status", str, sizeof (str))) {
-				st = UNKNOWN;  /* uh oh */
-			} else if (strcmp(str, "Charging\n") == 0) {
-				st = CHARGING;
-			} else if (strcmp(str, "Discharging\n") == 0) {
-				st = ON_BATTERY;
-			} else if ((strcmp(str, "Full\n") == 0) || (strcmp(str, "Not charging\n") == 0)) {
-				st = FULL;
-			} else {
-				st = UNKNOWN;  /* uh oh */
-			}
-			if (read_power_file(base, name, "capacity", str, sizeof (str))) {
-				pct = atoi(str);
-				pct = (pct > 100) ? 100 : pct; /* clamp between 0%, 100% */
+		if (!system) {
+			if (!grow((void **) &cache.ignored, &cache.ignored_size,
+			          cache.ignored_count, sizeof (cache.ignored[0]))) {
+				LOG("WARN", "Dropping power supply %s, out of memory", name);
+				continue;
 			}
+			strcpy(cache.ignored[cache.ignored_count++], name);
+			LOG("INFO", "Ignoring power supply %s", name);
+			continue;
+		}
 
-			if (read_power_file(base, name, "voltage_now", str, sizeof (str))) {
-				vlt = atoi(str);
-			}
+		if (!grow((void **) &cache.node, &cache.size, cache.count,
+		          sizeof (cache.node[0]))) {
+			LOG("WARN", "Dropping power supply %s, out of memory", name);
+			continue;
+		}
+		n = &cache.node[cache.count];
+		strcpy(n->name, name);
+		n->type = type;
+		n->uevent_fd = -1;
+		n->offered = 0;
+		n->st.state = UNKNOWN;
+		for (int a = 0; a < ATTR_MAX; a++) {
+			n->fd[a] = -1;
+			n->st.val[a] = NO_VALUE;
+		}
+		cache.count++;
 
-			if (read_power_file(base, name, "current_now", str, sizeof (str))) {
-				cur = atoi(str);
-			}
+		n->uevent_fd = open_power_file(base, name, "uevent");
+		for (int a = 0; a < ATTR_MAX; a++) {
+			if ((type == BATTERY) != (a == ATTR_ONLINE))
+				n->fd[a] = open_power_file(base, name, power_attr_names[a]);
+			if (n->fd[a] != -1)
+				n->offered |= ATTR_BIT(a);
+		}
+		if (type == BATTERY) {
+			n->chemistry = battery_chemistry(base, name);
+			n->resistance.valid = false;
+			n->resistance.mOhm = RESISTANCE_DEFAULT;
+			n->filter.valid = false;
+			n->filter.mAh = battery_design_capacity(base, name);
+			state_restore(n);
+			cache.batteries++;
+		}
+		LOG("INFO", "Using power supply %s", name);
+	}
 
-			if (read_power_file(base, name, "temp", str, sizeof (str))) {
-				temp = atoi(str);
-			}
+	closedir(dirp);
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	cache.checked = now.tv_sec;
+	cache.valid = true;
+	return true;
+}
 
-			if (read_power_file(base, name, "time_to_empty_now", str, sizeof (str))) {
-				secs = atoi(str);
-				secs = (secs <= 0) ? -1 : secs;  /* 0 == unknown */
-			}
+/* rebuild the cache if it was invalidated or the set of nodes changed */
+static bool
+cache_refresh(void)
+{
+	struct timespec now;
+	unsigned long listing;
 
-			/*
-			* We pick the battery that claims to have the most minutes left.
-			*  (failing a report of minutes, we'll take the highest percent.)
-			*/
+	if (!cache.valid) {
+		return cache_build();
+	}
 
-			if ((secs < 0) && (isnan(i->seconds))) {
-				if (isnan(i->fraction)) {
-					choose = true;  /* at least we know there's a battery. */
-				} else if (pct > i->fraction * 100) {
-					choose = true;
-				}
-			} else if (secs > i->seconds) {
-				choose = true;
-			}
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	if (now.tv_sec - cache.checked < RESCAN_INTERVAL) {
+		return true;
+	}
+	cache.checked = now.tv_sec;
+
+	if (!hash_listing(sys_class_power_supply_path, &listing)) {
+		cache_clear();
+		return false;
+	}
+	if (listing != cache.listing) {
+		LOG("INFO", "power_supply nodes changed, rescanning");
+		return cache_build();
+	}
+	return true;
+}
+
+void
+battery_set_sysfs_root(const char *root)
+{
+	snprintf(sys_class_power_supply_path, sizeof (sys_class_power_supply_path),
+	         "%s" POWER_SUPPLY_CLASS, root);
+	cache_clear();
+}
+
+void
+battery_set_backend(enum battery_backend b)
+{
+	backend = b;
+}
+
+bool
+battery_set_chemistry(const char *name)
+{
+	if (!name) {
+		chemistry = OCV_CHEMISTRIES;
+		cache_clear();
+		return true;
+	}
+	for (int c = 0; c < OCV_CHEMISTRIES; c++) {
+		if (strcmp(name, ocv_chemistry_names[c]) == 0) {
+			chemistry = c;
+			cache_clear();
+			return true;
+		}
+	}
+	return false;
+}
+
+void
+battery_invalidate(void)
+{
+	cache.valid = false;
+}
+
+void
+battery_set_state_file(const char *path)
+{
+	cache_clear();
+	snprintf(state_file, sizeof (state_file), "%s", path ? path : "");
+	if (state_file[0])
+		state_load();
+}
+
+void
+battery_close(void)
+{
+	cache_clear();
+	free(cache.node);
+	free(cache.ignored);
+	cache.node = NULL;
+	cache.ignored = NULL;
+	cache.size = 0;
+	cache.ignored_size = 0;
+	if (state_file[0])
+		state_save();
+}
+
+static bool
+int_string(char *str, int *val)
+{
+	char *endptr = NULL;
+	*val = (int) strtol(str, &endptr, 0);
+	return ((*str != '\0') && (*endptr == '\0'));
+}
+
+/* look up the state of charge (in permille) for an open circuit voltage */
+static int
+ocv_lookup(const uint16_t *table, int mV)
+{
+	int lo = 0, hi = OCV_POINTS - 1;
+
+	if (mV <= table[lo])
+		return 0;
+	if (mV >= table[hi])
+		return 1000;
+
+	/* table[lo] < mV < table[hi] */
+	while (hi - lo > 1) {
+		const int mid = (lo + hi) / 2;
+		if (table[mid] <= mV)
+			lo = mid;
+		else
+			hi = mid;
+	}
+	return lo * OCV_STEP + (mV - table[lo]) * OCV_STEP / (table[hi] - table[lo]);
+}
+
+/*
+ * Learn the series resistance of a battery from consecutive samples: the
+ * open circuit voltage barely moves between them, so a change in current
+ * shows up as V1 - V2 = (I2 - I1) * R.
+ *
+ * @mV: voltage measured outside the battery
+ * @mA: current flowing out of the battery
+ */
+static void
+resistance_update(struct power_node *n, int mV, int mA)
+{
+	struct resistance *r = &n->resistance;
+
+	if (r->valid && abs(mA - r->mA) >= RESISTANCE_MIN_STEP) {
+		const int mOhm = (r->mV - mV) * 1000 / (mA - r->mA);
+
+		/* anything else is noise or the cell relaxing */
+		if (mOhm >= RESISTANCE_MIN && mOhm <= RESISTANCE_MAX)
+			r->mOhm += (mOhm - r->mOhm) / RESISTANCE_WEIGHT;
+	}
+	r->mV = mV;
+	r->mA = mA;
+	r->valid = true;
+}
+
+/* estimate the state of charge (in permille) of a battery from its voltage,
+   corrected for the drop across its internal resistance */
+static int
+battery_estimate(const struct power_node *n)
+{
+	const int *val = n->st.val;
+	const int mV = val[ATTR_VOLTAGE_NOW] / 1000;
+	int mA = 100;
+
+	if (val[ATTR_CURRENT_NOW] != NO_VALUE)
+		mA = val[ATTR_CURRENT_NOW] / 1000;
+
+	LOG("INFO", "Running SOC estimation for %dmV and %dmA at %dmOhm", mV, mA, n->resistance.mOhm);
+	/* internal battery voltage is higher than measured when discharging */
+	return ocv_lookup(ocv_tables[n->chemistry], mV + n->resistance.mOhm * mA / 1000);
+}
+
+/* one step of the charge filter, for batteries that only report a voltage */
+static void
+soc_filter_update(struct power_node *n)
+{
+	struct soc_filter *f = &n->filter;
+	const int *val = n->st.val;
+	struct timespec ts;
+	long long now, dt;
+	int ppm;
+
+	if (val[ATTR_CAPACITY] != NO_VALUE || val[ATTR_VOLTAGE_NOW] == NO_VALUE) {
+		return;  /* the gauge knows better, or we know nothing */
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	now = ts.tv_sec * 1000LL + ts.tv_nsec / 1000000;
+	ppm = battery_estimate(n) * 1000;
+
+	if (!f->valid) {
+		f->valid = true;
+		f->ppm = ppm;
+		f->time = now;
+		return;
+	}
+
+	dt = now - f->time;
+	if (dt <= 0) {
+		return;
+	}
+	f->time = now;
+
+	/* coulomb count: mA * ms over mAh * 3600000 ms, in ppm */
+	if (f->mAh > 0 && val[ATTR_CURRENT_NOW] != NO_VALUE)
+		f->ppm -= (long long) (val[ATTR_CURRENT_NOW] / 1000) * dt * 1000 / (3600LL * f->mAh);
+	/* complementary part: the voltage model corrects the drift */
+	f->ppm += (long long) (ppm - f->ppm) * dt / (dt + SOC_FILTER_TAU);
+	f->ppm = min(max(f->ppm, 0), 1000000);
+}
+
+static unsigned int
+attrs_for_fields(unsigned int fields)
+{
+	unsigned int attrs = 0;
+
+	for (unsigned int f = 0; f < sizeof (field_attrs) / sizeof (field_attrs[0]); f++) {
+		if (fields & (1u << f))
+			attrs |= field_attrs[f];
+	}
+	return attrs;
+}
+
+static enum battery_state
+parse_state(const struct power_values *v)
+{
+	const char *str;
+
+	/* some drivers don't offer this, so if it's not explicitly reported assume it's present. */
+	if ((str = v->val[ATTR_PRESENT]) && (strcmp(str, "0") == 0)) {
+		return NO_BATTERY;
+	} else if ((str = v->val[ATTR_STATUS]) == NULL) {
+		return UNKNOWN;  /* uh oh */
+	} else if (strcmp(str, "Charging") == 0) {
+		return CHARGING;
+	} else if (strcmp(str, "Discharging") == 0) {
+		return ON_BATTERY;
+	} else if ((strcmp(str, "Full") == 0) || (strcmp(str, "Not charging") == 0)) {
+		return FULL;
+	}
+	return UNKNOWN;  /* uh oh */
+}
+
+/* remember what was read, attributes that were tried but are missing become unknown */
+static void
+node_store(struct power_node *n, const struct power_values *v)
+{
+	if (v->tried & ATTR_BIT(ATTR_STATUS))
+		n->st.state = parse_state(v);
 
-			if (choose) {
-				if (secs != -1)
-					i->seconds = secs;
-				else
-					i->seconds = NAN;
-				if (pct != -1)
-					i->fraction = pct/100.;
-				else
-					i->fraction = NAN;
-				i->state = st;
-				if (vlt != -1)
-					i->voltage = vlt/1000000.;
-				else
-					i->voltage = NAN;
-				if (cur != -999999999)
-					i->current = cur/1000000.;
-				else
-					i->current = NAN;
-				if (temp != -999999999)
-					i->temperature = temp/10.;
-				else
-					i->temperature = NAN;
-
-				if (isnan(i->fraction) || i->fraction > 100 || i->fraction < 0)
-					i->fraction = battery_estimate(i);
-				if (isnan(i->fraction) || i->fraction > 100 || i->fraction < 0)
-					i->fraction = 0;
+	for (int a = 0; a < ATTR_MAX; a++) {
+		int val;
+
+		if (a == ATTR_STATUS || !(v->tried & ATTR_BIT(a)))
+			continue;
+		if (v->val[a] && int_string((char *) v->val[a], &val))
+			n->st.val[a] = val;
+		else
+			n->st.val[a] = NO_VALUE;
+	}
+
+	if (n->type == BATTERY &&
+	    (v->tried & ESTIMATE_ATTRS) == ESTIMATE_ATTRS &&
+	    n->st.val[ATTR_VOLTAGE_NOW] != NO_VALUE &&
+	    n->st.val[ATTR_CURRENT_NOW] != NO_VALUE) {
+		resistance_update(n, n->st.val[ATTR_VOLTAGE_NOW] / 1000,
+		                  n->st.val[ATTR_CURRENT_NOW] / 1000);
+	}
+	if (n->type == BATTERY && (v->tried & ATTR_BIT(ATTR_VOLTAGE_NOW)))
+		soc_filter_update(n);
+}
+
+static void
+read_nodes(unsigned int fields)
+{
+	unsigned int attrs = attrs_for_fields(fields);
+
+	if ((fields & BATTERY_FRACTION) && cache.batteries > 1)
+		attrs |= AGGREGATE_ATTRS;
+
+	for (int idx = 0; idx < cache.count; idx++) {
+		struct power_node *n = &cache.node[idx];
+		struct power_values v;
+
+		if (is_input(n->type) && !(fields & BATTERY_SOURCE))
+			continue;
+
+		read_node(n, &v, attrs);
+		if (n->type == BATTERY && (fields & BATTERY_FRACTION) &&
+		    !v.val[ATTR_CAPACITY]) {
+			/* no capacity, battery_estimate will need these */
+			read_node_files(n, &v, ESTIMATE_ATTRS);
+		}
+		node_store(n, &v);
+	}
+}
+
+/* sum of an attribute over the present batteries, -1 unless all have it */
+static long long
+sum_batteries(enum power_attr attr)
+{
+	long long sum = 0;
+
+	for (int idx = 0; idx < cache.count; idx++) {
+		const struct power_node *n = &cache.node[idx];
+
+		if (n->type != BATTERY || n->st.state == NO_BATTERY)
+			continue;
+		if (n->st.val[attr] == NO_VALUE || n->st.val[attr] < 0)
+			return -1;
+		sum += n->st.val[attr];
+	}
+	return sum;
+}
+
+/* the charge of all batteries together, by energy if they all report it */
+static double
+aggregate_fraction(void)
+{
+	static const enum power_attr pairs[][2] = {
+		{ ATTR_ENERGY_NOW, ATTR_ENERGY_FULL },
+		{ ATTR_CHARGE_NOW, ATTR_CHARGE_FULL },
+	};
+
+	for (size_t p = 0; p < sizeof (pairs) / sizeof (pairs[0]); p++) {
+		const long long now = sum_batteries(pairs[p][0]);
+		const long long full = sum_batteries(pairs[p][1]);
+
+		if (now >= 0 && full > 0)
+			return min((double) now / full, 1.);
+	}
+	return NAN;
+}
+
+/* seconds until a charging battery is full, what the driver says or what is
+   missing over the current; -1 if unknown */
+static double
+node_seconds_to_full(const struct power_node *n)
+{
+	const int *val = n->st.val;
+	double current;
+
+	if (n->st.state != CHARGING)
+		return -1;
+	if (val[ATTR_TIME_TO_FULL_NOW] != NO_VALUE && val[ATTR_TIME_TO_FULL_NOW] > 0)
+		return val[ATTR_TIME_TO_FULL_NOW];
+	if (val[ATTR_CURRENT_NOW] == NO_VALUE || val[ATTR_CURRENT_NOW] == 0)
+		return -1;
+
+	/* drivers disagree on the sign while charging */
+	current = fabs((double) val[ATTR_CURRENT_NOW]);
+	if (val[ATTR_CHARGE_NOW] != NO_VALUE && val[ATTR_CHARGE_FULL] != NO_VALUE &&
+	    val[ATTR_CHARGE_FULL] > val[ATTR_CHARGE_NOW])
+		return (double) (val[ATTR_CHARGE_FULL] - val[ATTR_CHARGE_NOW]) * 3600 / current;
+	if (val[ATTR_ENERGY_NOW] != NO_VALUE && val[ATTR_ENERGY_FULL] != NO_VALUE &&
+	    val[ATTR_ENERGY_FULL] > val[ATTR_ENERGY_NOW] &&
+	    val[ATTR_VOLTAGE_NOW] != NO_VALUE && val[ATTR_VOLTAGE_NOW] > 0)
+		return (double) (val[ATTR_ENERGY_FULL] - val[ATTR_ENERGY_NOW]) * 3600 /
+		       (current * val[ATTR_VOLTAGE_NOW] / 1000000.);
+	return -1;
+}
+
+/* compute battery_info from what the nodes last reported, no I/O */
+static void
+aggregate(struct battery_info *i, unsigned int fields)
+{
+	int present = 0, charging = 0, discharging = 0, full = 0;
+	int permille_sum = 0, permille_count = 0;
+	int secs_sum = 0, secs_count = 0;
+	double to_full = -1;
+	long long vlt_sum = 0, cur_sum = 0;
+	int vlt_count = 0, cur_count = 0;
+	int temp = NO_VALUE;
+	bool inputs = false, online = false;
+
+	/* assume we're just plugged in. */
+	i->state = NO_BATTERY;
+	i->seconds = NAN;
+	i->seconds_to_full = NAN;
+	i->fraction = NAN;
+	i->voltage = NAN;
+	i->current = NAN;
+	i->temperature = NAN;
+	i->source = UNKOWN;
+
+	for (int idx = 0; idx < cache.count; idx++) {
+		const struct power_node *n = &cache.node[idx];
+		const int *val = n->st.val;
+
+		if (is_input(n->type)) {
+			inputs = true;
+			if (!online && val[ATTR_ONLINE] != NO_VALUE && val[ATTR_ONLINE] != 0) {
+				i->source = n->type;
+				online = true;
 			}
+			continue;
 		}
 
-		if (type == USB && read_power_file(base, name, "online", str, sizeof (str))) {
-			if (strcmp(str, "0\n") == 0)
-				i->source = BATTERY;
-			else if (strcmp(str, "0\n") == 1)
-				i->source = USB;
+		if (n->st.state == NO_BATTERY)
+			continue;
+		present++;
+		charging += n->st.state == CHARGING;
+		discharging += n->st.state == ON_BATTERY;
+		full += n->st.state == FULL;
+
+		if (!(fields & BATTERY_FRACTION)) {
+			/* nothing to estimate */
+		} else if (val[ATTR_CAPACITY] != NO_VALUE && val[ATTR_CAPACITY] >= 0) {
+			permille_sum += min(val[ATTR_CAPACITY], 100) * 10; /* clamp between 0%, 100% */
+			permille_count++;
+		} else if (n->filter.valid) {
+			permille_sum += n->filter.ppm / 1000;
+			permille_count++;
+		} else if (val[ATTR_VOLTAGE_NOW] != NO_VALUE) {
+			permille_sum += battery_estimate(n);
+			permille_count++;
+		}
+		if (val[ATTR_TIME_TO_EMPTY_NOW] != NO_VALUE && val[ATTR_TIME_TO_EMPTY_NOW] > 0) {
+			secs_sum += val[ATTR_TIME_TO_EMPTY_NOW];  /* 0 == unknown */
+			secs_count++;
 		}
+		/* charged in parallel, the slowest one decides */
+		to_full = max(to_full, node_seconds_to_full(n));
+		if (val[ATTR_VOLTAGE_NOW] != NO_VALUE) {
+			vlt_sum += val[ATTR_VOLTAGE_NOW];
+			vlt_count++;
+		}
+		if (val[ATTR_CURRENT_NOW] != NO_VALUE) {
+			cur_sum += val[ATTR_CURRENT_NOW];
+			cur_count++;
+		}
+		if (val[ATTR_TEMP] != NO_VALUE)
+			temp = max(temp, val[ATTR_TEMP]);
+	}
 
+	if (inputs && !online)
+		i->source = BATTERY;
+	if (!(fields & BATTERY_SOURCE))
+		i->source = UNKOWN;
+
+	if (present == 0)
+		return;
+
+	if (!(fields & BATTERY_STATE))
+		i->state = UNKNOWN;
+	else if (charging)
+		i->state = CHARGING;
+	else if (discharging)
+		i->state = ON_BATTERY;
+	else if (full == present)
+		i->state = FULL;
+	else
+		i->state = UNKNOWN;
+
+	/* batteries drained one after the other, or in parallel: the times add up */
+	if (secs_count)
+		i->seconds = secs_sum;
+	if (to_full >= 0)
+		i->seconds_to_full = to_full;
+	/* packs of one device are in parallel, average the voltage, add up the current */
+	if (vlt_count)
+		i->voltage = vlt_sum / vlt_count / 1000000.;
+	if (cur_count)
+		i->current = cur_sum / 1000000.;
+	if (temp != NO_VALUE)
+		i->temperature = temp / 10.;
+
+	if (fields & BATTERY_FRACTION) {
+		if (present > 1)
+			i->fraction = aggregate_fraction();
+		if (isnan(i->fraction) && permille_count)
+			i->fraction = permille_sum / permille_count / 1000.;
+		if (isnan(i->fraction) || i->fraction > 1 || i->fraction < 0)
+			i->fraction = 0;
 	}
 
-	closedir(dirp);
+	/* only asked for to estimate the fraction */
+	if (!(fields & BATTERY_VOLTAGE))
+		i->voltage = NAN;
+	if (!(fields & BATTERY_CURRENT))
+		i->current = NAN;
+	if (!(fields & BATTERY_SECONDS))
+		i->seconds = NAN;
+	if (!(fields & BATTERY_SECONDS_TO_FULL))
+		i->seconds_to_full = NAN;
+	if (!(fields & BATTERY_TEMPERATURE))
+		i->temperature = NAN;
+}
+
+bool
+battery_fill_info_mask(struct battery_info *i, unsigned int fields)
+{
+	if (!cache_refresh()) {
+		return false;
+	}
+
+	read_nodes(fields);
+
+	/* a node went away while we were reading, try once more with a fresh view */
+	if (!cache.valid) {
+		if (!cache_build()) {
+			return false;
+		}
+		read_nodes(fields);
+	}
+
+	aggregate(i, fields);
 	return true;  /* don't look any further. */
 }
 
+bool
+battery_update_uevent(const char *name, const char *payload, size_t len)
+{
+	struct power_values v;
+
+	if (!cache.valid) {
+		return false;
+	}
+
+	for (int idx = 0; idx < cache.count; idx++) {
+		struct power_node *n = &cache.node[idx];
+
+		if (strcmp(n->name, name) != 0)
+			continue;
+		if (len >= sizeof (v.buf))
+			return false;
+
+		/* the message carries every property, like the uevent file */
+		memcpy(v.buf, payload, len);
+		v.buf[len] = '\0';
+		parse_uevent(v.buf, len, '\0', &v);
+		node_store(n, &v);
+		return true;
+	}
+	for (int idx = 0; idx < cache.ignored_count; idx++) {
+		if (strcmp(cache.ignored[idx], name) == 0)
+			return true;  /* nothing we look at changed */
+	}
+	return false;
+}
+
+bool
+battery_aggregate(struct battery_info *i, unsigned int fields)
+{
+	if (!cache.valid) {
+		return false;
+	}
+	aggregate(i, fields);
+	return true;
+}
+
+bool
+battery_fill_info(struct battery_info *i)
+{
+	return battery_fill_info_mask(i, BATTERY_ALL);
+}
+
 char *battery_state_string(enum battery_state s)
 {
 	switch (s) {
@@ -299,6 +1307,7 @@ void battery_dump(struct battery_info *i)
 {
 	printf("Battery %.0f %%\n", i->fraction * 100);
 	printf("Seconds %.0f\n", i->seconds);
+	printf("Seconds to full %.0f\n", i->seconds_to_full);
 	printf("State %d -- %s\n", i->state, battery_state_string(i->state));
 	printf("Voltage %.2f V\n", i->voltage);
 	printf("Current %.3f A\n", i->current);
@@ -6,6 +6,7 @@
  */
 
 #include <stdbool.h>
+#include <stddef.h>
 
 enum battery_state {
   NO_BATTERY,
@@ -15,10 +16,13 @@ enum battery_state {
   FULL,
 };
 
+/* where the power comes from, the type of the first online input */
 enum power_state {
   BATTERY,
   USB,
   UNKOWN,
+  MAINS,
+  WIRELESS,
 };
 
 struct battery {
@@ -30,12 +34,57 @@ struct battery_info {
 	enum battery_state state;
 	double fraction; /* 1 == 100% */
 	double seconds;
+	double seconds_to_full; /* while charging */
 	double voltage;	/* In volts */
 	double current; /* In amperes, < 0 charging, > 0 discharging */
 	double temperature; /* Degrees celsius */
 };
 
+/* fields of struct battery_info, for battery_fill_info_mask */
+enum battery_field {
+  BATTERY_FRACTION    = 1 << 0,
+  BATTERY_SECONDS     = 1 << 1,
+  BATTERY_STATE       = 1 << 2,
+  BATTERY_VOLTAGE     = 1 << 3,
+  BATTERY_CURRENT     = 1 << 4,
+  BATTERY_TEMPERATURE = 1 << 5,
+  BATTERY_SOURCE      = 1 << 6,
+  BATTERY_SECONDS_TO_FULL = 1 << 7,
+  BATTERY_ALL         = (1 << 8) - 1,
+};
+
+enum battery_backend {
+  BATTERY_BACKEND_AUTO,   /* uevent where available, single files otherwise */
+  BATTERY_BACKEND_UEVENT,
+  BATTERY_BACKEND_FILES,
+};
+
+/* values of all system batteries are combined, by energy (or charge) where
+   every battery reports it */
 extern bool battery_fill_info(struct battery_info *i);
+/* like battery_fill_info, but only read what the fields (BATTERY_* flags)
+   need; the other fields are NAN (or UNKNOWN / UNKOWN) */
+extern bool battery_fill_info_mask(struct battery_info *i, unsigned int fields);
+extern void battery_set_backend(enum battery_backend b);
+/* OCV curve ("liion", "lihv" or "lifepo4") used to estimate the charge of
+   batteries without capacity, NULL to go by their technology; false if the
+   name is unknown */
+extern bool battery_set_chemistry(const char *name);
+/* apply a power_supply uevent (its NUL separated KEY=VALUE payload) to the
+   node it is about; false if the node is unknown and a full read is needed */
+extern bool battery_update_uevent(const char *name, const char *payload, size_t len);
+/* battery_fill_info_mask from the values last read or received, no I/O;
+   false if there are none */
+extern bool battery_aggregate(struct battery_info *i, unsigned int fields);
+/* look for power_supply nodes below root instead of /sys */
+extern void battery_set_sysfs_root(const char *root);
+/* forget the cached power_supply nodes, they are rescanned on the next fill */
+extern void battery_invalidate(void);
+/* remember what was learned about the batteries in path over restarts,
+   loaded now and written by battery_close; NULL to not */
+extern void battery_set_state_file(const char *path);
+/* release the attribute files kept open by battery_fill_info */
+extern void battery_close(void);
 extern void battery_dump(struct battery_info *i);
 
 
@@ -0,0 +1,211 @@
+/*
+ * Benchmark of battery_fill_info() against synthetic power_supply trees.
+ *
+ * Prints one JSON object per configuration:
+ *   {"bench":"battery_fill_info","variant":...,"supplies":...,"samples":...,
+ *    "ns_per_sample":...,"syscalls_per_sample":...,"syscr_per_sample":...,
+ *    "allocs_per_sample":...}
+ *
+ * usage: bench_battery [samples]
+ */
+
+#define _XOPEN_SOURCE 700
+
+#include <ftw.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "battery.h"
+#include "counters.h"
+
+#define DEFAULT_SAMPLES 20000
+
+enum variant {
+    VARIANT_UEVENT, /* cached nodes, one uevent read per node */
+    VARIANT_FILES, /* cached nodes, one pread per attribute */
+    VARIANT_RESCAN, /* node cache dropped before every sample */
+    VARIANT_MASKED, /* cached nodes, only the fields the sampler uses */
+};
+
+static const char* const variant_names[] = {
+    [VARIANT_UEVENT] = "uevent",
+    [VARIANT_FILES] = "files",
+    [VARIANT_RESCAN] = "rescan",
+    [VARIANT_MASKED] = "masked",
+};
+
+/* what battery_device_update asks for, and while a charger is online */
+#define SAMPLER_FIELDS (BATTERY_FRACTION | BATTERY_CURRENT | BATTERY_SOURCE)
+#define SAMPLER_CHARGING_FIELDS (SAMPLER_FIELDS | BATTERY_SECONDS_TO_FULL)
+
+static void write_attr(const char* dir, const char* attr, const char* value)
+{
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", dir, attr);
+    FILE* f = fopen(path, "w");
+    if (!f) {
+        perror(path);
+        exit(1);
+    }
+    fprintf(f, "%s\n", value);
+    fclose(f);
+}
+
+/* a supply with its attribute files and a matching uevent file */
+static void add_supply(const char* root, const char* name, const char* type,
+    const char* scope, const char* const* attrs)
+{
+    char dir[512];
+    char uevent[2048];
+    int len;
+
+    snprintf(dir, sizeof(dir), "%s/class/power_supply/%s", root, name);
+    mkdir(dir, 0755);
+
+    len = snprintf(uevent, sizeof(uevent), "POWER_SUPPLY_NAME=%s\nPOWER_SUPPLY_TYPE=%s\n", name, type);
+    write_attr(dir, "type", type);
+    if (scope) {
+        write_attr(dir, "scope", scope);
+        len += snprintf(uevent + len, sizeof(uevent) - len, "POWER_SUPPLY_SCOPE=%s\n", scope);
+    }
+    for (; attrs && attrs[0]; attrs += 2) {
+        char key[64];
+        int i;
+
+        write_attr(dir, attrs[0], attrs[1]);
+        for (i = 0; attrs[0][i] && i < (int)sizeof(key) - 1; ++i)
+            key[i] = attrs[0][i] >= 'a' && attrs[0][i] <= 'z' ? attrs[0][i] - 'a' + 'A' : attrs[0][i];
+        key[i] = '\0';
+        len += snprintf(uevent + len, sizeof(uevent) - len, "POWER_SUPPLY_%s=%s\n", key, attrs[1]);
+    }
+    write_attr(dir, "uevent", uevent);
+}
+
+/* one system battery and a charger, then whatever else a modern board has */
+static void make_tree(const char* root, int supplies)
+{
+    static const char* const battery[] = {
+        "present", "1", "status", "Charging", "capacity", "64",
+        "voltage_now", "3912000", "current_now", "-420000", "temp", "287",
+        "time_to_empty_now", "0", NULL
+    };
+    static const char* const online[] = { "online", "1", NULL };
+    static const char* const offline[] = { "online", "0", NULL };
+    static const char* const device_battery[] = { "present", "1", "status", "Discharging", "capacity", "30", NULL };
+    char path[512];
+
+    snprintf(path, sizeof(path), "%s/class", root);
+    mkdir(path, 0755);
+    snprintf(path, sizeof(path), "%s/class/power_supply", root);
+    mkdir(path, 0755);
+
+    add_supply(root, "battery", "Battery", NULL, battery);
+    if (supplies > 1)
+        add_supply(root, "usb", "USB", NULL, online);
+
+    for (int i = 2; i < supplies; ++i) {
+        char name[64];
+        switch (i % 4) {
+        case 0:
+            snprintf(name, sizeof(name), "ucsi-source-psy-%i", i);
+            add_supply(root, name, "USB", NULL, offline);
+            break;
+        case 1:
+            snprintf(name, sizeof(name), "wireless-%i", i);
+            add_supply(root, name, "Wireless", NULL, offline);
+            break;
+        case 2:
+            snprintf(name, sizeof(name), "hid-controller-%i", i);
+            add_supply(root, name, "Battery", "Device", device_battery);
+            break;
+        default:
+            snprintf(name, sizeof(name), "mains-%i", i);
+            add_supply(root, name, "Mains", NULL, offline);
+            break;
+        }
+    }
+}
+
+static int remove_entry(const char* path, const struct stat* sb, int flag, struct FTW* ftw)
+{
+    return remove(path);
+}
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void run(const char* root, enum variant variant, int supplies, long samples)
+{
+    struct battery_info info;
+    struct counters c;
+    unsigned int fields = variant == VARIANT_MASKED ? SAMPLER_FIELDS : BATTERY_ALL;
+
+    battery_set_sysfs_root(root);
+    battery_set_backend(variant == VARIANT_FILES ? BATTERY_BACKEND_FILES : BATTERY_BACKEND_AUTO);
+
+    /* warm up, this also builds the node cache */
+    if (!battery_fill_info_mask(&info, fields)) {
+        fprintf(stderr, "battery_fill_info failed on %s\n", root);
+        exit(1);
+    }
+    if (variant == VARIANT_MASKED && info.source != BATTERY && info.source != UNKOWN)
+        fields = SAMPLER_CHARGING_FIELDS;
+
+    counters_start();
+    uint64_t start = now_ns();
+    for (long i = 0; i < samples; ++i) {
+        if (variant == VARIANT_RESCAN)
+            battery_invalidate();
+        battery_fill_info_mask(&info, fields);
+    }
+    uint64_t elapsed = now_ns() - start;
+    counters_stop(&c);
+
+    printf("{\"bench\":\"battery_fill_info\",\"variant\":\"%s\",\"supplies\":%i,\"samples\":%li,"
+           "\"ns_per_sample\":%.0f,\"syscalls_per_sample\":%.2f,\"syscr_per_sample\":%.2f,"
+           "\"allocs_per_sample\":%.2f}\n",
+        variant_names[variant], supplies, samples,
+        (double)elapsed / samples, (double)c.syscalls / samples,
+        (double)c.syscr / samples, (double)c.allocs / samples);
+    fflush(stdout);
+}
+
+int main(int argc, char** argv)
+{
+    static const int sizes[] = { 2, 4, 8, 16, 32 };
+    long samples = argc > 1 ? atol(argv[1]) : DEFAULT_SAMPLES;
+    const char* tmp = getenv("TMPDIR");
+    char root[512];
+
+    if (samples <= 0) {
+        fprintf(stderr, "usage: %s [samples]\n", argv[0]);
+        return 1;
+    }
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+        snprintf(root, sizeof(root), "%s/charge-mode-bench.XXXXXX", tmp ? tmp : "/tmp");
+        if (!mkdtemp(root)) {
+            perror("mkdtemp");
+            return 1;
+        }
+        make_tree(root, sizes[s]);
+
+        run(root, VARIANT_UEVENT, sizes[s], samples);
+        run(root, VARIANT_FILES, sizes[s], samples);
+        run(root, VARIANT_MASKED, sizes[s], samples);
+        /* rescanning is what every sample used to cost, it is slow */
+        run(root, VARIANT_RESCAN, sizes[s], samples / 10 > 0 ? samples / 10 : 1);
+
+        battery_close();
+        nftw(root, remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+    }
+    return 0;
+}
@@ -0,0 +1,75 @@
+/*
+ * Benchmark of the draw.c rasterizer: the lightning bolt filled to the size
+ * of common panels.
+ *
+ * Prints one JSON object per resolution:
+ *   {"bench":"make_lightning_icon","width":...,"height":...,"iterations":...,
+ *    "ns_per_icon":...,"ns_per_fill":...}
+ *
+ * usage: bench_draw [iterations]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "draw.h"
+
+#define DEFAULT_ITERATIONS 200
+
+struct resolution {
+    int w;
+    int h;
+};
+
+static double elapsed_ns(Uint64 start)
+{
+    return (double)(SDL_GetPerformanceCounter() - start) * 1e9 / SDL_GetPerformanceFrequency();
+}
+
+int main(int argc, char** argv)
+{
+    static const struct resolution resolutions[] = {
+        { 854, 480 },
+        { 1920, 1080 },
+        { 2560, 1440 },
+    };
+    long iterations = argc > 1 ? atol(argv[1]) : DEFAULT_ITERATIONS;
+
+    if (iterations <= 0) {
+        fprintf(stderr, "usage: %s [iterations]\n", argv[0]);
+        return 1;
+    }
+
+    for (size_t r = 0; r < sizeof(resolutions) / sizeof(resolutions[0]); ++r) {
+        const int w = resolutions[r].w;
+        const int h = resolutions[r].h;
+
+        /* whole icon, surface allocation and clearing included */
+        Uint64 start = SDL_GetPerformanceCounter();
+        for (long i = 0; i < iterations; ++i)
+            SDL_FreeSurface(make_lightning_icon(w, h, ICON_FORMAT));
+        double icon_ns = elapsed_ns(start) / iterations;
+
+        /* the fill alone, the same outline make_lightning_icon uses */
+        SDL_Surface* surf = make_lightning_icon(w, h, ICON_FORMAT);
+        if (!surf) {
+            fprintf(stderr, "can not create %ix%i surface\n", w, h);
+            return 1;
+        }
+        SDL_Point outline[LIGHTNING_POINTS];
+        make_lightning_outline(w, h, outline);
+        Uint32 color = SDL_MapRGBA(surf->format, 255, 255, 255, 255);
+
+        start = SDL_GetPerformanceCounter();
+        for (long i = 0; i < iterations; ++i)
+            fill_polygon(surf, color, outline, LIGHTNING_POINTS);
+        double fill_ns = elapsed_ns(start) / iterations;
+        SDL_FreeSurface(surf);
+
+        printf("{\"bench\":\"make_lightning_icon\",\"width\":%i,\"height\":%i,\"iterations\":%li,"
+               "\"ns_per_icon\":%.0f,\"ns_per_fill\":%.0f}\n",
+            w, h, iterations, icon_ns, fill_ns);
+        fflush(stdout);
+    }
+    return 0;
+}
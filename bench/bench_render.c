@@ -0,0 +1,290 @@
+/*
+ * Benchmark and golden frame check of the renderers.
+ *
+ * By default prints the cost of a frame, one JSON object per renderer and
+ * resolution:
+ *   {"bench":"render_frame","renderer":...,"width":...,"height":...,
+ *    "frames":...,"cpu_ns_per_frame":...,"wall_ns_per_frame":...}
+ * "soft" is the CPU painter the kms and headless renderers use, "sdl-*" the
+ * SDL renderer with the given render driver in a window (pick the video driver
+ * with SDL_VIDEODRIVER, e.g. offscreen) and "gles" the shader renderer. Every
+ * frame has a different charge level, so the SDL renderer bakes a new gauge
+ * each time. The windowed renderers also report what their init costs:
+ *   {"bench":"render_init","renderer":...,"wall_ns":...}
+ *
+ * With -u DIR the CPU painter renders a small matrix of resolutions and
+ * charge levels into DIR as WIDTHxHEIGHT-PERCENT.ppm. With -g DIR it renders
+ * the same matrix and compares it against those files, printing one JSON
+ * object per frame that differs and saving it next to the golden one as
+ * *.fail.ppm. The exit status is 1 if any frame differs. The frames in
+ * test/golden are checked by make check.
+ *
+ * usage: bench_render [-n frames] [-u DIR | -g DIR]
+ */
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "draw.h"
+#include "render.h"
+
+#define DEFAULT_FRAMES 200
+
+struct resolution {
+    int w;
+    int h;
+};
+
+static const struct resolution resolutions[] = {
+    { 480, 854 },
+    { 540, 960 },
+    { 720, 1280 },
+    { 1080, 1920 },
+    { 1920, 1080 },
+};
+
+/* the golden frames are committed, keep them few and small; portrait and
+   landscape, the color thresholds, empty and full */
+static const struct resolution golden_resolutions[] = {
+    { 240, 427 },
+    { 427, 240 },
+};
+
+static const int golden_percents[] = { 0, 5, 20, 50, 100 };
+
+static const char* const sdl_drivers[] = { "software", "opengles2" };
+
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+
+static double now_ns(clockid_t clock)
+{
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static struct frame_state bench_frame(long i)
+{
+    struct frame_state frame = {
+        .percent = i % 101,
+        .charging = true,
+        .minutes_to_full = (100 - i % 101) * 3 / 2,
+        .battery_visible = true,
+    };
+    return frame;
+}
+
+static void print_cost(const char* renderer, int w, int h, long frames, double cpu_ns, double wall_ns)
+{
+    printf("{\"bench\":\"render_frame\",\"renderer\":\"%s\",\"width\":%i,\"height\":%i,\"frames\":%li,"
+           "\"cpu_ns_per_frame\":%.0f,\"wall_ns_per_frame\":%.0f}\n",
+        renderer, w, h, frames, cpu_ns / frames, wall_ns / frames);
+    fflush(stdout);
+}
+
+static int bench_soft(long frames)
+{
+    const struct render_options options = { .icon_format = ICON_FORMAT };
+
+    for (size_t r = 0; r < ARRAY_SIZE(resolutions); ++r) {
+        const int w = resolutions[r].w;
+        const int h = resolutions[r].h;
+        struct soft_painter painter;
+        SDL_Surface* target = SDL_CreateRGBSurfaceWithFormat(0, w, h, 32, SDL_PIXELFORMAT_RGB888);
+
+        if (!target || !soft_painter_init(&painter, w, h, &options)) {
+            fprintf(stderr, "can not create %ix%i painter\n", w, h);
+            return 1;
+        }
+
+        double cpu = now_ns(CLOCK_PROCESS_CPUTIME_ID);
+        double wall = now_ns(CLOCK_MONOTONIC);
+        for (long i = 0; i < frames; ++i) {
+            struct frame_state frame = bench_frame(i);
+            soft_painter_draw(&painter, target, &frame);
+        }
+        print_cost("soft", w, h, frames, now_ns(CLOCK_PROCESS_CPUTIME_ID) - cpu, now_ns(CLOCK_MONOTONIC) - wall);
+
+        soft_painter_destroy(&painter);
+        SDL_FreeSurface(target);
+    }
+    return 0;
+}
+
+static void bench_window(const char* name, const struct render_backend* template, long frames)
+{
+    const struct render_options options = { .window = true, .icon_format = ICON_FORMAT };
+    struct render_backend backend = *template;
+
+    double wall = now_ns(CLOCK_MONOTONIC);
+    if (!backend.init(&backend, &options)) {
+        printf("{\"bench\":\"render_frame\",\"renderer\":\"%s\",\"error\":\"unavailable\"}\n", name);
+        fflush(stdout);
+        return;
+    }
+    printf("{\"bench\":\"render_init\",\"renderer\":\"%s\",\"wall_ns\":%.0f}\n", name,
+        now_ns(CLOCK_MONOTONIC) - wall);
+
+    double cpu = now_ns(CLOCK_PROCESS_CPUTIME_ID);
+    wall = now_ns(CLOCK_MONOTONIC);
+    for (long i = 0; i < frames; ++i) {
+        struct frame_state frame = bench_frame(i);
+        backend.draw(&backend, &frame);
+    }
+    print_cost(name, backend.width, backend.height, frames, now_ns(CLOCK_PROCESS_CPUTIME_ID) - cpu,
+        now_ns(CLOCK_MONOTONIC) - wall);
+
+    backend.destroy(&backend);
+}
+
+static void bench_sdl(long frames)
+{
+    for (size_t d = 0; d < ARRAY_SIZE(sdl_drivers); ++d) {
+        char name[64];
+
+        snprintf(name, sizeof(name), "sdl-%s", sdl_drivers[d]);
+        SDL_SetHint(SDL_HINT_RENDER_DRIVER, sdl_drivers[d]);
+        bench_window(name, &render_backend_sdl, frames);
+    }
+    bench_window("gles", &render_backend_gles, frames);
+}
+
+/* the pixels of a binary PPM, 3 bytes each, or NULL if it is not one of w by h */
+static Uint8* read_ppm(const char* path, int w, int h)
+{
+    FILE* file = fopen(path, "rb");
+    Uint8* pixels;
+    int file_w, file_h, max;
+
+    if (!file)
+        return NULL;
+
+    if (fscanf(file, "P6 %i %i %i", &file_w, &file_h, &max) != 3 || fgetc(file) == EOF
+        || file_w != w || file_h != h || max != 255) {
+        fclose(file);
+        return NULL;
+    }
+
+    pixels = malloc((size_t)w * h * 3);
+    if (pixels && fread(pixels, 3, (size_t)w * h, file) != (size_t)w * h) {
+        free(pixels);
+        pixels = NULL;
+    }
+    fclose(file);
+    return pixels;
+}
+
+/* pixels of an RGB24 surface that differ from a PPM */
+static long count_differences(SDL_Surface* surface, const Uint8* ppm)
+{
+    long differences = 0;
+
+    for (int y = 0; y < surface->h; ++y) {
+        const Uint8* row = (const Uint8*)surface->pixels + y * surface->pitch;
+        const Uint8* golden = ppm + (size_t)y * surface->w * 3;
+
+        for (int x = 0; x < surface->w * 3; x += 3) {
+            if (memcmp(row + x, golden + x, 3) != 0)
+                ++differences;
+        }
+    }
+    return differences;
+}
+
+static int golden(const char* dir, bool update)
+{
+    const struct render_options options = { .icon_format = ICON_FORMAT };
+    int failed = 0;
+
+    for (size_t r = 0; r < ARRAY_SIZE(golden_resolutions); ++r) {
+        const int w = golden_resolutions[r].w;
+        const int h = golden_resolutions[r].h;
+        struct soft_painter painter;
+        /* byte for byte what a PPM holds, up to the row padding */
+        SDL_Surface* target = SDL_CreateRGBSurfaceWithFormat(0, w, h, 24, SDL_PIXELFORMAT_RGB24);
+
+        if (!target || !soft_painter_init(&painter, w, h, &options)) {
+            fprintf(stderr, "can not create %ix%i painter\n", w, h);
+            return 1;
+        }
+
+        for (size_t p = 0; p < ARRAY_SIZE(golden_percents); ++p) {
+            struct frame_state frame = {
+                .percent = golden_percents[p],
+                .charging = true,
+                .minutes_to_full = (100 - golden_percents[p]) * 3 / 2,
+                .battery_visible = true,
+            };
+            char path[PATH_MAX];
+
+            soft_painter_draw(&painter, target, &frame);
+            snprintf(path, sizeof(path), "%s/%ix%i-%i.ppm", dir, w, h, golden_percents[p]);
+
+            if (update) {
+                if (render_write_ppm(target, path) < 0)
+                    failed = 1;
+                continue;
+            }
+
+            Uint8* ppm = read_ppm(path, w, h);
+            long differences = ppm ? count_differences(target, ppm) : (long)w * h;
+            free(ppm);
+            if (differences == 0)
+                continue;
+
+            printf("{\"golden\":\"%s\",\"width\":%i,\"height\":%i,\"percent\":%i,\"differing_pixels\":%li}\n",
+                path, w, h, golden_percents[p], differences);
+            snprintf(path, sizeof(path), "%s/%ix%i-%i.fail.ppm", dir, w, h, golden_percents[p]);
+            render_write_ppm(target, path);
+            failed = 1;
+        }
+
+        soft_painter_destroy(&painter);
+        SDL_FreeSurface(target);
+    }
+    return failed;
+}
+
+int main(int argc, char** argv)
+{
+    long frames = DEFAULT_FRAMES;
+    const char* dir = NULL;
+    bool update = false;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:u:g:")) != -1) {
+        switch (opt) {
+        case 'n':
+            frames = atol(optarg);
+            break;
+        case 'u':
+            dir = optarg;
+            update = true;
+            break;
+        case 'g':
+            dir = optarg;
+            update = false;
+            break;
+        default:
+            frames = 0;
+            break;
+        }
+    }
+
+    if (frames <= 0) {
+        fprintf(stderr, "usage: %s [-n frames] [-u DIR | -g DIR]\n", argv[0]);
+        return 1;
+    }
+
+    if (dir)
+        return golden(dir, update);
+
+    if (bench_soft(frames) != 0)
+        return 1;
+    bench_sdl(frames);
+    return 0;
+}
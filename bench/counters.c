@@ -0,0 +1,181 @@
+/*
+ * Call counters for the benchmarks.
+ *
+ * The file functions are hooked with the linker's --wrap, so only calls made
+ * by the objects linked into the benchmark are seen, which is what we want
+ * to measure.  malloc and friends are replaced outright so that allocations
+ * libc makes on our behalf (opendir, ...) are counted too; this relies on
+ * glibc's __libc_* entry points.
+ */
+
+#include "counters.h"
+
+#include <dirent.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+static bool counting;
+static uint64_t syscalls;
+static uint64_t allocs;
+static uint64_t syscr_start;
+
+static uint64_t read_syscr(void)
+{
+    char buf[512];
+    uint64_t syscr = 0;
+
+    FILE* f = fopen("/proc/self/io", "r");
+    if (!f)
+        return 0;
+    while (fgets(buf, sizeof(buf), f)) {
+        if (sscanf(buf, "syscr: %lu", &syscr) == 1)
+            break;
+    }
+    fclose(f);
+    return syscr;
+}
+
+void counters_start(void)
+{
+    syscr_start = read_syscr();
+    syscalls = 0;
+    allocs = 0;
+    counting = true;
+}
+
+void counters_stop(struct counters* out)
+{
+    counting = false;
+    out->syscalls = syscalls;
+    out->allocs = allocs;
+    out->syscr = read_syscr() - syscr_start;
+}
+
+#define COUNT() \
+    if (counting) \
+        ++syscalls
+
+int __real_open(const char* path, int flags, ...);
+int __real_open64(const char* path, int flags, ...);
+ssize_t __real_read(int fd, void* buf, size_t count);
+ssize_t __real_pread(int fd, void* buf, size_t count, off_t offset);
+ssize_t __real_pread64(int fd, void* buf, size_t count, off_t offset);
+int __real_close(int fd);
+int __real_access(const char* path, int mode);
+DIR* __real_opendir(const char* path);
+struct dirent* __real_readdir(DIR* dir);
+struct dirent* __real_readdir64(DIR* dir);
+int __real_closedir(DIR* dir);
+
+int __wrap_open(const char* path, int flags, ...)
+{
+    va_list ap;
+    va_start(ap, flags);
+    mode_t mode = va_arg(ap, mode_t);
+    va_end(ap);
+    COUNT();
+    return __real_open(path, flags, mode);
+}
+
+int __wrap_open64(const char* path, int flags, ...)
+{
+    va_list ap;
+    va_start(ap, flags);
+    mode_t mode = va_arg(ap, mode_t);
+    va_end(ap);
+    COUNT();
+    return __real_open64(path, flags, mode);
+}
+
+ssize_t __wrap_read(int fd, void* buf, size_t count)
+{
+    COUNT();
+    return __real_read(fd, buf, count);
+}
+
+ssize_t __wrap_pread(int fd, void* buf, size_t count, off_t offset)
+{
+    COUNT();
+    return __real_pread(fd, buf, count, offset);
+}
+
+ssize_t __wrap_pread64(int fd, void* buf, size_t count, off_t offset)
+{
+    COUNT();
+    return __real_pread64(fd, buf, count, offset);
+}
+
+int __wrap_close(int fd)
+{
+    COUNT();
+    return __real_close(fd);
+}
+
+int __wrap_access(const char* path, int mode)
+{
+    COUNT();
+    return __real_access(path, mode);
+}
+
+/* opendir is openat + fstat, closedir a close */
+DIR* __wrap_opendir(const char* path)
+{
+    if (counting)
+        syscalls += 2;
+    return __real_opendir(path);
+}
+
+int __wrap_closedir(DIR* dir)
+{
+    COUNT();
+    return __real_closedir(dir);
+}
+
+/* readdir only enters the kernel when its buffer runs dry, getdents is not
+   visible from here, so count one per call as an upper bound */
+struct dirent* __wrap_readdir(DIR* dir)
+{
+    COUNT();
+    return __real_readdir(dir);
+}
+
+struct dirent* __wrap_readdir64(DIR* dir)
+{
+    COUNT();
+    return __real_readdir64(dir);
+}
+
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t nmemb, size_t size);
+extern void* __libc_realloc(void* ptr, size_t size);
+extern void __libc_free(void* ptr);
+
+void* malloc(size_t size)
+{
+    if (counting)
+        ++allocs;
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t nmemb, size_t size)
+{
+    if (counting)
+        ++allocs;
+    return __libc_calloc(nmemb, size);
+}
+
+void* realloc(void* ptr, size_t size)
+{
+    if (counting)
+        ++allocs;
+    return __libc_realloc(ptr, size);
+}
+
+void free(void* ptr)
+{
+    __libc_free(ptr);
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* what the wrapped libc entry points saw while counting was enabled */
+struct counters {
+    uint64_t syscalls; /* open/read/pread/close/access/... calls from our code */
+    uint64_t allocs; /* malloc/calloc/realloc calls, including libc internal ones */
+    uint64_t syscr; /* read syscalls according to /proc/self/io */
+};
+
+/**
+  reset the counters and start counting
+*/
+void counters_start(void);
+
+/**
+  stop counting and fetch the totals since counters_start
+*/
+void counters_stop(struct counters* out);
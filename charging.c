@@ -1,8 +1,6 @@
 #include <SDL2/SDL.h>
 
 #include <SDL2/SDL_stdinc.h>
-#include <sys/ioctl.h>
-#include <linux/rtc.h>
 #include <fcntl.h>
 #include <stdlib.h>
 #include <time.h>
@@ -10,27 +8,62 @@
 #include <stdint.h>
 #include <signal.h>
 #include <time.h>
+#include <string.h>
+#include <sys/signalfd.h>
+#include <sys/resource.h>
 
 #include <unistd.h>
-#include <GLES2/gl2.h>
 
 #include "battery.h"
 #include "draw.h"
 #include "log.h"
 #include "backlight.h"
+#include "render.h"
+#include "sampler.h"
+#include "eventloop.h"
+#include "scheduler.h"
+#include "input.h"
+#include "suspend.h"
+#include "rtc_alarm.h"
 
 #define CHARGING_SDL_VERSION "1.2"
 
 #define SCREENTIME 5
 
+/* ms the backlight takes to go dark after SCREENTIME */
+#define FADE_OUT 500
+
+/* boot on our own above this charge with -b */
+#define AUTOBOOT_PERCENT 20
+
+/* seconds an RTC alarm may be past and still count as what woke us */
+#define ALARM_GRACE 300
+
 #define RTC_DEVICE "/dev/rtc0"
 
-#define CHECK_CREATE_SUCCESS(obj)                               \
-    if (!obj) {                                                 \
-        ERROR("failed to allocate object: %s", SDL_GetError()); \
-        SDL_Quit();                                             \
-        exit(-1);                                                \
-    }
+#define SYSFS_ROOT "/sys"
+
+#define RENDERER "sdl"
+
+/* what was learned about the battery; kept over reboots, charge mode is mostly
+   entered from one */
+#define STATE_FILE "/var/lib/charge-mode/battery"
+
+/* ms bounds of the battery poll interval, the scheduler picks within them */
+#define POLL_MIN 1000
+#define POLL_MAX 60000
+
+/* ms after the charger came or went during which we sample fast */
+#define PLUG_SETTLE 30000
+
+/* ms between frames while the battery blinks */
+#define BLINK_INTERVAL 250
+
+/* ms between moves of the burn-in prevention square */
+#define OLED_INTERVAL 1000
+
+/* ms between SDL event pumps in window mode, where input is not on evdev */
+#define WINDOW_PUMP_INTERVAL 50
 
 enum {
     EXIT_BOOT = 0,
@@ -38,113 +71,188 @@ enum {
     EXIT_ALARM = 2
 };
 
-sig_atomic_t running = true;
-sig_atomic_t retreason = EXIT_BOOT;
-
-void int_handler(int dummy)
-{
-    running = false;
-}
-
-void alarm_handler(int dummy)
-{
-    running = false;
-    retreason = EXIT_ALARM;
-}
+bool running = true;
+int retreason = EXIT_BOOT;
 
 void usage(char* appname)
 {
-    printf("Usage: %s [-oeaw] \n\
+    printf("Usage: %s [-oeawtbm] [-s sysfs] [-r rtc] [-R renderer] [-C chemistry] [-i min:max] [-B backlight] [-S suspend]\n\
     -o: prevent burn-in on OLED screens\n\
     -e: exit immediately if not charging\n\
     -a: exit on rtc alarm\n\
     -w: run in window\n\
     -t: use mock battery\n\
-    -b: autoboot when battery is > 20%%\n",
-        appname);
+    -b: autoboot when battery is > 20%%\n\
+    -m: build icons in 16 bit color to save memory\n\
+    -s: sysfs root to read power supplies and backlights from (default %s, env CHARGE_MODE_SYSFS)\n\
+    -r: rtc device (default %s, env CHARGE_MODE_RTC)\n\
+    -R: renderer, sdl, gles, kms or headless (default %s, env CHARGE_MODE_RENDERER)\n\
+    -C: battery chemistry for estimating a missing capacity, liion, lihv or lifepo4\n\
+        (default from the battery's technology, env CHARGE_MODE_CHEMISTRY)\n\
+    -i: bounds of the battery poll interval in ms (default %u:%u, env CHARGE_MODE_POLL)\n\
+    -B: backlight device (default the preferred one by type, env CHARGE_MODE_BACKLIGHT)\n\
+    -S: suspend while the screen is off, mem or sleep (default off, env CHARGE_MODE_SUSPEND)\n",
+        appname, SYSFS_ROOT, RTC_DEVICE, RENDERER, POLL_MIN, POLL_MAX);
 }
 
-struct battery_device {
-    double current;
-    int is_charging;
-    int percent;
+struct config
+{
+    bool flag_oled:1;
+    bool flag_exit:1;
+    bool flag_alarm:1;
+    bool flag_window:1;
+    bool flag_mock_bat:1;
+    bool flag_autoboot:1;
+    bool flag_low_memory:1;
+    const char* sysfs_root;
+    const char* rtc_device;
+    const char* renderer;
+    const char* chemistry;
+    struct schedule_bounds poll;
+    const char* backlight;
+    const char* suspend;
 };
 
-int set_alarm_from_rtc(int rtc_fd)
+/**
+  decide what to do from one look at the power state, before any graphics
+  @returns the EXIT_* code to leave with, or -1 if charge mode is to be shown
+*/
+int early_decision(const struct config* config, const struct rtc_alarm* alarm,
+    const struct battery_device* bat)
 {
-    struct rtc_wkalrm wake;
-    struct tm tm = { 0 };
-    time_t alarm_time;
+    if (config->flag_alarm && alarm->when) {
+        const time_t now = time(NULL);
+        if (alarm->when <= now && now - alarm->when <= ALARM_GRACE) {
+            LOG("INFO", "woken by rtc alarm");
+            return EXIT_ALARM;
+        }
+    }
 
-    if (ioctl(rtc_fd, RTC_WKALM_RD, &wake) < 0)
-        return -1;
+    if (config->flag_exit && !bat->is_charging) {
+        LOG("INFO", "not charging, booting");
+        return EXIT_BOOT;
+    }
 
-    if (wake.enabled != 1 || wake.time.tm_year == -1)
-        return 1;
+    if (config->flag_autoboot && bat->is_charging && bat->percent > AUTOBOOT_PERCENT) {
+        LOG("INFO", "battery at %i%%, booting", bat->percent);
+        return EXIT_BOOT;
+    }
 
-    tm.tm_sec = wake.time.tm_sec;
-    tm.tm_min = wake.time.tm_min;
-    tm.tm_hour = wake.time.tm_hour;
-    tm.tm_mday = wake.time.tm_mday;
-    tm.tm_mon = wake.time.tm_mon;
-    tm.tm_year = wake.time.tm_year;
-    tm.tm_isdst = -1;  /* assume the system knows better than the RTC */
+    return -1;
+}
 
-    alarm_time = mktime(&tm);
-    if (alarm_time == (time_t)-1)
-        return -1;
+/* what the event handlers saw, consumed by the main loop */
+struct wakeup {
+    struct sampler* sampler;
+    bool power_changed;
+    bool screen_timeout;
+    bool blink_tick;
+    bool oled_tick;
+    bool unplug_expired; /* waiting for a fresh sample to confirm the unplug */
+    bool unplugged;
+    bool plug_settled;
+    bool key_pressed;
+    bool power_pressed;
+    bool keys_lost;
+};
 
-    double delta = difftime(time(NULL), alarm_time);
+void on_signal(int fd, uint32_t events, void* data)
+{
+    struct signalfd_siginfo info;
 
-    if (delta > 0)
-        alarm((unsigned int)delta);
+    while (read(fd, &info, sizeof(info)) == sizeof(info)) {
+        LOG("INFO", "got signal %u", info.ssi_signo);
+        running = false;
+    }
+}
 
-    return 0;
+void on_rtc_alarm(int fd, uint32_t events, void* data)
+{
+    if (rtc_alarm_ack(data)) {
+        LOG("INFO", "rtc alarm");
+        retreason = EXIT_ALARM;
+        running = false;
+    }
 }
 
-void update_bat_info(struct battery_device* dev, bool mock)
+void on_sample(int fd, uint32_t events, void* data)
 {
-    if(!mock)
-    {
-        struct battery_info bat;
-        LOG("INFO", "Reading Battery");
-        if (battery_fill_info(&bat)) {
-            dev->current = bat.current;
-            if (!isfinite(bat.fraction) || bat.fraction <= 0) {
-                dev->percent = 1;
-                LOG("WARN", "Battery Percent out of range");
-            } else {
-                dev->percent = (int)(bat.fraction * 100.0);
-            }
-            LOG("INFO", "Battery Percent: %d", dev->percent);
-            dev->is_charging = bat.source == USB;
-        } else {
-            LOG("WARN", "Could not read battery");
-        }
+    struct wakeup* wakeup = data;
+
+    if (!sampler_ack(wakeup->sampler))
+        return;
+    wakeup->power_changed = true;
+    if (wakeup->unplug_expired) {
+        wakeup->unplug_expired = false;
+        wakeup->unplugged = true;
     }
-    else
-    {
-        static int state = 0;
-        const int percents[] = {50, 90, 10, 0, 1, -1, 100};
-        LOG("INFO", "mock percentage: %i", percents[state]);
-        dev->is_charging = true;
-        dev->current = -10;
-        dev->percent = percents[state++];
-        if(state > (sizeof(percents)/sizeof(percents[0]))-1)
-            state = 0;
+}
+
+void on_screen_timer(int fd, uint32_t events, void* data)
+{
+    struct wakeup* wakeup = data;
+    timer_ack(fd);
+    wakeup->screen_timeout = true;
+}
+
+void on_blink_timer(int fd, uint32_t events, void* data)
+{
+    struct wakeup* wakeup = data;
+    timer_ack(fd);
+    wakeup->blink_tick = true;
+}
+
+void on_oled_timer(int fd, uint32_t events, void* data)
+{
+    struct wakeup* wakeup = data;
+    timer_ack(fd);
+    wakeup->oled_tick = true;
+}
+
+void on_unplug_timer(int fd, uint32_t events, void* data)
+{
+    struct wakeup* wakeup = data;
+    timer_ack(fd);
+    /* look at the charger once more before giving up on it */
+    wakeup->unplug_expired = true;
+    sampler_request(wakeup->sampler);
+}
+
+void on_plug_timer(int fd, uint32_t events, void* data)
+{
+    struct wakeup* wakeup = data;
+    timer_ack(fd);
+    wakeup->plug_settled = true;
+}
 
+void on_pump_timer(int fd, uint32_t events, void* data)
+{
+    timer_ack(fd);
+}
+
+void on_key(enum input_action action, void* data)
+{
+    struct wakeup* wakeup = data;
+    if (action == INPUT_LOST) {
+        wakeup->keys_lost = true;
+        return;
     }
+    wakeup->key_pressed = true;
+    if (action == INPUT_POWER)
+        wakeup->power_pressed = true;
 }
 
-struct config
+/* without evdev keys, SDL is the only way left to the power key */
+static bool use_sdl_keys(const struct render_backend* backend, int pump_timer)
 {
-    bool flag_oled:1;
-    bool flag_exit:1;
-    bool flag_alarm:1;
-    bool flag_window:1;
-    bool flag_mock_bat:1;
-    bool flag_autoboot:1;
-};
+    if (!backend->handles_input) {
+        ERROR("no power or volume keys, the power key will not work");
+        return false;
+    }
+    LOG("WARN", "reading keys through SDL");
+    timer_arm(pump_timer, WINDOW_PUMP_INTERVAL, true);
+    return true;
+}
 
 int main(int argc, char** argv)
 {
@@ -153,25 +261,45 @@ int main(int argc, char** argv)
 
     struct config config = {0};
 
-    int screen_w = 540;
-    int screen_h = 960;
-
-    int rtc_fd;
+    struct rtc_alarm rtc_alarm = { .rtc_fd = -1, .timer_fd = -1 };
 
-    SDL_Window* window;
-    SDL_Renderer* renderer;
+    struct battery_device bat_info = { .seconds_to_full = -1 };
 
-    struct battery_device bat_info = {};
-    SDL_Surface* battery_icon;
-    SDL_Surface* lightning_icon;
+    struct event_loop loop;
+    if (event_loop_init(&loop) < 0)
+        return -1;
 
-    signal(SIGINT, int_handler);
-    signal(SIGHUP, int_handler);
-    signal(SIGTERM, int_handler);
-    signal(SIGALRM, alarm_handler);
+    /* signals are delivered through the event loop */
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGHUP);
+    sigaddset(&signals, SIGTERM);
+    int signal_fd = signal_fd_new(&signals);
+    if (signal_fd < 0)
+        return -1;
+    event_loop_add(&loop, signal_fd, on_signal, NULL);
+
+    config.sysfs_root = getenv("CHARGE_MODE_SYSFS");
+    if (!config.sysfs_root)
+        config.sysfs_root = SYSFS_ROOT;
+    config.rtc_device = getenv("CHARGE_MODE_RTC");
+    if (!config.rtc_device)
+        config.rtc_device = RTC_DEVICE;
+    config.renderer = getenv("CHARGE_MODE_RENDERER");
+    if (!config.renderer)
+        config.renderer = RENDERER;
+    config.chemistry = getenv("CHARGE_MODE_CHEMISTRY");
+    config.backlight = getenv("CHARGE_MODE_BACKLIGHT");
+    config.suspend = getenv("CHARGE_MODE_SUSPEND");
+    config.poll = (struct schedule_bounds) { POLL_MIN, POLL_MAX };
+    const char* poll_bounds = getenv("CHARGE_MODE_POLL");
+    if (poll_bounds && !schedule_parse_bounds(poll_bounds, &config.poll)) {
+        ERROR("invalid poll bounds in CHARGE_MODE_POLL: %s", poll_bounds);
+    }
 
     int opt;
-    while ((opt = getopt(argc, argv, "obeawt")) != -1) {
+    while ((opt = getopt(argc, argv, "obeawtms:r:R:C:i:B:S:")) != -1) {
         switch (opt) {
         case 'o':
             config.flag_oled = true;
@@ -191,210 +319,358 @@ int main(int argc, char** argv)
         case 'b':
             config.flag_autoboot = true;
             break;
+        case 'm':
+            config.flag_low_memory = true;
+            break;
+        case 's':
+            config.sysfs_root = optarg;
+            break;
+        case 'r':
+            config.rtc_device = optarg;
+            break;
+        case 'R':
+            config.renderer = optarg;
+            break;
+        case 'C':
+            config.chemistry = optarg;
+            break;
+        case 'B':
+            config.backlight = optarg;
+            break;
+        case 'S':
+            config.suspend = optarg;
+            break;
+        case 'i':
+            if (!schedule_parse_bounds(optarg, &config.poll)) {
+                ERROR("invalid poll bounds: %s", optarg);
+                usage(argv[0]);
+                return -1;
+            }
+            break;
         default:
             usage(argv[0]);
             return -1;
         }
     }
 
-    rtc_fd = open(RTC_DEVICE, O_RDONLY | O_CLOEXEC);
-    if(rtc_fd < 0) {
-        LOG("INFO", "failed to open RTC: %s", RTC_DEVICE);
-    } else if (set_alarm_from_rtc(rtc_fd) != 0) {
-        LOG("INFO", "failed to read RTC: %s", RTC_DEVICE);
-    }
-
-    if(rtc_fd >= 0)
-        close(rtc_fd);
-
-    if (config.flag_exit) {
-        update_bat_info(&bat_info, config.flag_mock_bat);
-        if (!bat_info.is_charging)
-            return retreason;
-    }
-
-    int max_brightness = 0;
-    int brightness_file = open_brightness_file(&max_brightness);
-
-    if (SDL_Init(SDL_INIT_EVENTS | SDL_INIT_VIDEO) < 0) {
-        ERROR("failed to init SDL: %s", SDL_GetError());
+    const struct render_backend* backend_template = render_backend_find(config.renderer);
+    if (!backend_template) {
+        ERROR("unknown renderer: %s", config.renderer);
+        usage(argv[0]);
         return -1;
     }
 
-    SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_ES);
-    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 2);
-    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 0);
-
-    if (config.flag_window) {
-        LOG("INFO", "creating test window");
-        window = SDL_CreateWindow("Charge - Test Mode",
-            SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
-            screen_w, screen_h, 0);
-    } else {
-        SDL_DisplayMode mode = { SDL_PIXELFORMAT_UNKNOWN, 0, 0, 0, 0 };
-        if (SDL_GetDisplayMode(0, 0, &mode) != 0) {
-            ERROR("error fetching display mode: %s", SDL_GetError());
-            SDL_Quit();
+    const struct suspend_backend* suspend_template = NULL;
+    if (config.suspend) {
+        suspend_template = suspend_backend_find(config.suspend);
+        if (!suspend_template) {
+            ERROR("unknown suspend mode: %s", config.suspend);
+            usage(argv[0]);
             return -1;
         }
-        screen_w = mode.w;
-        screen_h = mode.h;
-        LOG("INFO", "creating window");
-        window = SDL_CreateWindow("Charge",
-            SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
-            0, 0, SDL_WINDOW_FULLSCREEN | SDL_WINDOW_SHOWN);
     }
-    CHECK_CREATE_SUCCESS(window);
 
-    if (SDL_ShowCursor(SDL_DISABLE) < 0 )
-        LOG("WARNING", "Failed to disable cursor");
-
-    LOG("INFO" "using video driver: %s", SDL_GetCurrentVideoDriver());
+    battery_set_sysfs_root(config.sysfs_root);
+    if (!config.flag_mock_bat) {
+        const char* state_file = getenv("CHARGE_MODE_STATE");
+        battery_set_state_file(state_file ? state_file : STATE_FILE);
+    }
+    if (!battery_set_chemistry(config.chemistry)) {
+        ERROR("unknown battery chemistry: %s", config.chemistry);
+        usage(argv[0]);
+        return -1;
+    }
 
-    LOG("INFO", "creating general renderer");
-    renderer = SDL_CreateRenderer(window, -1, 0);
-    CHECK_CREATE_SUCCESS(renderer);
+    if (config.flag_alarm)
+        rtc_alarm_open(&rtc_alarm, config.rtc_device);
+
+    /* most plug-in boots end here, don't bring up graphics just to leave */
+    battery_device_update(&bat_info, config.flag_mock_bat);
+    int decision = early_decision(&config, &rtc_alarm, &bat_info);
+    if (decision >= 0) {
+        battery_close();
+        rtc_alarm_close(&rtc_alarm);
+        close(signal_fd);
+        event_loop_destroy(&loop);
+        return decision;
+    }
 
-    LOG("INFO", glGetString(GL_RENDERER));
+    if (rtc_alarm.timer_fd >= 0)
+        event_loop_add(&loop, rtc_alarm.timer_fd, on_rtc_alarm, &rtc_alarm);
 
-    SDL_Rect battery_rect;
-    make_battery_rect(screen_w, screen_h, &battery_rect);
+    struct backlight backlight;
+    backlight_open(&backlight, config.sysfs_root, config.backlight, &loop);
 
-    LOG("INFO", "creating icon bitmaps");
-    battery_icon = make_battery_icon(battery_rect, screen_w, screen_h);
-    CHECK_CREATE_SUCCESS(battery_icon);
+    struct suspend suspend;
+    bool can_suspend = suspend_template
+        && suspend_init(&suspend, suspend_template, config.sysfs_root, config.rtc_device);
+    if (can_suspend) {
+        LOG("INFO", "suspending with %s while the screen is off", suspend.backend.name);
+    }
 
-    SDL_Rect is_charging_area = {
-        .x = 0,
-        .y = screen_w / 8 * 0.2,
-        .w = screen_w / 8,
-        .h = screen_w / 8
+    /* battery reads can block on the fuel gauge, keep them off this thread */
+    struct sampler sampler;
+    if (sampler_start(&sampler, config.flag_mock_bat, config.poll.min, &bat_info) < 0)
+        return -1;
+    struct wakeup wakeup = { .sampler = &sampler, .power_changed = true };
+    event_loop_add(&loop, sampler.notify_fd, on_sample, &wakeup);
+
+    int screen_timer = timer_new();
+    int blink_timer = timer_new();
+    int unplug_timer = timer_new();
+    int pump_timer = timer_new();
+    int oled_timer = timer_new();
+    int plug_timer = timer_new();
+    if (screen_timer < 0 || blink_timer < 0 || unplug_timer < 0 || pump_timer < 0
+        || oled_timer < 0 || plug_timer < 0)
+        return -1;
+    event_loop_add(&loop, screen_timer, on_screen_timer, &wakeup);
+    event_loop_add(&loop, blink_timer, on_blink_timer, &wakeup);
+    event_loop_add(&loop, unplug_timer, on_unplug_timer, &wakeup);
+    event_loop_add(&loop, pump_timer, on_pump_timer, NULL);
+    event_loop_add(&loop, oled_timer, on_oled_timer, &wakeup);
+    event_loop_add(&loop, plug_timer, on_plug_timer, &wakeup);
+
+    struct input input = { 0 };
+
+    struct render_backend backend = *backend_template;
+    struct render_options render_options = {
+        .window = config.flag_window,
+        .oled = config.flag_oled,
+        .icon_format = config.flag_low_memory ? ICON_FORMAT_16BIT : ICON_FORMAT,
     };
+    LOG("INFO", "using %s renderer", backend.name);
+    if (!backend.init(&backend, &render_options))
+        return -1;
 
-    lightning_icon = make_lightning_icon(is_charging_area.w, is_charging_area.h);
-    CHECK_CREATE_SUCCESS(battery_icon);
-
-    LOG("INFO", "creating textures from icons");
-    SDL_Texture* battery_icon_texture = SDL_CreateTextureFromSurface(renderer, battery_icon);
-    CHECK_CREATE_SUCCESS(battery_icon_texture);
-
-    SDL_Texture* lightning_icon_texture = SDL_CreateTextureFromSurface(renderer, lightning_icon);
-    CHECK_CREATE_SUCCESS(lightning_icon_texture);
+    int screen_w = backend.width;
+    int screen_h = backend.height;
+    /* a window gets its input from the display server, not from evdev */
+    bool sdl_input = backend.handles_input && config.flag_window;
 
-    SDL_RenderClear(renderer);
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        LOG("INFO", "peak RSS after startup: %ld kB", usage.ru_maxrss);
+    }
 
     SDL_Event ev;
-    Uint32 start = SDL_GetTicks();
-    Uint32 last_charging = SDL_GetTicks();
     Uint32 frame = 0;
 
-    SDL_Rect oled_rect;
+    SDL_Rect oled_rect = { 0 };
     if (config.flag_oled) {
+        struct render_layout layout;
         srand(time(NULL));
-        make_oled_rect(screen_h, &oled_rect);
+        render_layout(screen_w, screen_h, &layout);
+        oled_rect = layout.oled;
+        move_oled_rect(screen_w, screen_h, &oled_rect);
+        timer_arm(oled_timer, OLED_INTERVAL, true);
     }
 
-    int *keys;
+    if (sdl_input) {
+        timer_arm(pump_timer, WINDOW_PUMP_INTERVAL, true);
+    } else if (input_open(&input, &loop, INPUT_DIR, on_key, &wakeup) == 0) {
+        /* no permission or udev did not make the nodes yet */
+        LOG("WARN", "no power or volume keys found");
+        sdl_input = use_sdl_keys(&backend, pump_timer);
+    }
+
+    timer_arm(screen_timer, SCREENTIME * 1000, false);
 
     bool displayOn = true;
+    bool unplug_pending = false;
+    struct frame_state shown;
+    bool shown_valid = false;
     Uint32 blinking = 0;
+    bool wait_for_sample = false; /* after a resume, until the fresh sample is in */
 
-    while (running) {
-        update_bat_info(&bat_info, config.flag_mock_bat);
+    /* start attentive, we were most likely just plugged in */
+    struct schedule_state schedule = {
+        .charging = bat_info.is_charging,
+        .recent_plug = true,
+        .uevents = sampler_has_uevents(&sampler),
+    };
+    unsigned int poll_interval = config.poll.min;
+    timer_arm(plug_timer, PLUG_SETTLE, false);
 
-        ++frame;
-        blinking = blinking == 0 ? 0 : blinking - 1;
+    /* wakeups of both threads, to see what an interval actually costs */
+    unsigned int wakeups = 0;
+    struct wakeup_rate total_rate, interval_rate;
+    wakeup_rate_reset(&total_rate, 0);
+    wakeup_rate_reset(&interval_rate, 0);
 
-        if (displayOn) {
-            SDL_RenderClear(renderer);
+    while (running) {
+        if (wakeup.power_changed) {
+            wakeup.power_changed = false;
+            wait_for_sample = false;
+            sampler_latest(&sampler, &bat_info);
+        }
 
-            if (bat_info.is_charging) {
-                SDL_RenderCopy(renderer, lightning_icon_texture, NULL, &is_charging_area);
-                last_charging = SDL_GetTicks();
-                if(config.flag_autoboot && bat_info.percent > 20) {
-                    retreason = EXIT_BOOT;
-                    running = false;
-                }
-            } else if (config.flag_exit && SDL_GetTicks() - last_charging >= 2000) {
-                retreason = EXIT_SHUTDOWN;
+        if (bat_info.is_charging != schedule.charging) {
+            schedule.recent_plug = true;
+            wakeup.plug_settled = false;
+            timer_arm(plug_timer, PLUG_SETTLE, false);
+        } else if (wakeup.plug_settled) {
+            wakeup.plug_settled = false;
+            schedule.recent_plug = false;
+        }
+        schedule.charging = bat_info.is_charging;
+        schedule.percent = bat_info.percent;
+        schedule.display_on = displayOn;
+
+        unsigned int next_interval = schedule_poll_interval(&config.poll, &schedule);
+        if (next_interval != poll_interval) {
+            const unsigned int total = wakeups + sampler_wakeups(&sampler);
+            LOG("INFO", "battery poll interval %u ms, was %u ms at %.3f wakeups/s",
+                next_interval, poll_interval, wakeup_rate(&interval_rate, total));
+            sampler_set_interval(&sampler, next_interval);
+            poll_interval = next_interval;
+            wakeup_rate_reset(&interval_rate, total);
+        }
+
+        if (bat_info.is_charging) {
+            if (unplug_pending) {
+                timer_arm(unplug_timer, 0, false);
+                unplug_pending = false;
+            }
+            wakeup.unplug_expired = false;
+            wakeup.unplugged = false;
+            if(config.flag_autoboot && bat_info.percent > AUTOBOOT_PERCENT) {
+                retreason = EXIT_BOOT;
                 running = false;
+                break;
             }
+        } else if (wakeup.unplugged) {
+            retreason = EXIT_SHUTDOWN;
+            running = false;
+            break;
+        } else if (config.flag_exit && !unplug_pending) {
+            timer_arm(unplug_timer, 2000, false);
+            unplug_pending = true;
+        }
 
-            if(frame % 2 || blinking == 0) {
-                SDL_RenderCopy(renderer, battery_icon_texture, NULL, NULL);
+        struct frame_state next = {
+            .percent = bat_info.percent,
+            .charging = bat_info.is_charging,
+            .minutes_to_full = bat_info.is_charging && bat_info.seconds_to_full >= 0 ? bat_info.seconds_to_full / 60 : -1,
+            .battery_visible = frame % 2 || blinking == 0,
+            .oled = { oled_rect.x, oled_rect.y },
+        };
+
+        /* the panel keeps showing the last frame, only redraw on changes */
+        if (displayOn && (!shown_valid || !frame_state_equal(&next, &shown))) {
+            backend.draw(&backend, &next);
+            shown = next;
+            shown_valid = true;
+        }
 
-                if (config.flag_oled) {
-                    SDL_SetRenderDrawColor(renderer, 128, 128, 128, 255);
-                    SDL_RenderFillRect(renderer, &oled_rect);
-                    move_oled_rect(screen_w, screen_h, &oled_rect);
-                }
+        /* with nothing on screen and nothing going on, the next sample can wait in suspend */
+        bool try_suspend = can_suspend && !displayOn && !backlight_fading(&backlight)
+            && !unplug_pending && blinking == 0 && !schedule.recent_plug && !wait_for_sample;
 
-                SDL_Rect bat_ch_rect;
-                bat_ch_rect.x = battery_rect.x + battery_rect.h * 0.05;
-                bat_ch_rect.y = battery_rect.y + (battery_rect.h*0.90) * (100 - bat_info.percent)/100.0f + battery_rect.h * 0.05;
-                bat_ch_rect.h = battery_rect.h - bat_ch_rect.y + battery_rect.y - battery_rect.h * 0.05;
-                bat_ch_rect.w = battery_rect.w - battery_rect.h * 0.1;
+        /* sleep until a timer expires or something happens */
+        int handled = event_loop_dispatch(&loop, try_suspend ? 0 : -1);
+        if (handled < 0)
+            break;
 
-                SDL_SetRenderDrawColor(renderer, (100-bat_info.percent)/100.0f*255, bat_info.percent/100.0f*255, 0, 255);
-                SDL_RenderFillRect(renderer, &bat_ch_rect);
+        if (try_suspend && handled == 0) {
+            wait_for_sample = true;
+            /* an alarm that came due meanwhile is reported by its timer */
+            if (suspend_for(&suspend, (poll_interval + 999) / 1000) == 0) {
+                /* the autoboot and unplug rules get a fresh look at the battery */
+                sampler_request(&sampler);
             }
+            continue;
+        }
+        ++wakeups;
 
-            if(config.flag_window)
-                LOG("INFO", "refresh");
-            SDL_RenderPresent(renderer);
+        if (wakeup.blink_tick) {
+            wakeup.blink_tick = false;
+            ++frame;
+            if (blinking > 0 && --blinking == 0)
+                timer_arm(blink_timer, 0, false);
         }
-        while (SDL_PollEvent(&ev)) {
+
+        if (wakeup.oled_tick) {
+            wakeup.oled_tick = false;
+            if (displayOn)
+                move_oled_rect(screen_w, screen_h, &oled_rect);
+        }
+
+        bool key_pressed = wakeup.key_pressed;
+        bool power_pressed = wakeup.power_pressed;
+        wakeup.key_pressed = false;
+        wakeup.power_pressed = false;
+        if (wakeup.keys_lost) {
+            wakeup.keys_lost = false;
+            if (!sdl_input)
+                sdl_input = use_sdl_keys(&backend, pump_timer);
+        }
+        while (sdl_input && SDL_PollEvent(&ev)) {
             if (ev.type == SDL_KEYDOWN) {
-                update_bat_info(&bat_info, config.flag_mock_bat);
+                key_pressed = true;
                 /* Droid 4 power button registers as 1073741824 this is a sdl bug*/
-                if(ev.key.keysym.sym == SDLK_POWER || ev.key.keysym.sym == 1073741824) {
-                    if(bat_info.percent > 5) {
-                        retreason = EXIT_BOOT;
-                        running = false;
-                        break;
-                    }
-                    else {
-                        blinking = 10;
-                    }
+                if (ev.key.keysym.sym == SDLK_POWER || ev.key.keysym.sym == 1073741824)
+                    power_pressed = true;
+            }
+        }
+
+        if (key_pressed) {
+            /* decide on what we have, the fresh sample shows up on screen when it arrives */
+            sampler_request(&sampler);
+            if (power_pressed) {
+                if(bat_info.percent > 5) {
+                    retreason = EXIT_BOOT;
+                    running = false;
+                    break;
                 }
-                if(brightness_file >= 0) {
-                    char buf[256] = "";
-                    int len = snprintf(buf, 256, "%i", max_brightness);
-                    write(brightness_file, buf, len < 256 ? len : 256);
-                    displayOn = true;
+                else {
+                    blinking = 10;
+                    timer_arm(blink_timer, BLINK_INTERVAL, true);
                 }
-                start = SDL_GetTicks();
             }
+            if (backlight.fd >= 0) {
+                backlight_set(&backlight, backlight.max);
+                if (!displayOn)
+                    shown_valid = false;
+                displayOn = true;
+                if (config.flag_oled)
+                    timer_arm(oled_timer, OLED_INTERVAL, true);
+            }
+            wakeup.screen_timeout = false;
+            timer_arm(screen_timer, SCREENTIME * 1000, false);
         }
-        if(blinking == 0)
-            SDL_Delay(1000);
-        else
-            SDL_Delay(250);
-        if (SDL_GetTicks() - start >= SCREENTIME * 1000) {
-            if(brightness_file >= 0) {
-                char buf = '0';
-                write(brightness_file, &buf, 1);
+
+        if (wakeup.screen_timeout) {
+            wakeup.screen_timeout = false;
+            if (backlight.fd >= 0) {
+                backlight_fade(&backlight, 0, FADE_OUT);
                 displayOn = false;
+                timer_arm(oled_timer, 0, false);
             }
         }
     }
 
-    SDL_FreeSurface(lightning_icon);
-    SDL_FreeSurface(battery_icon);
-
-    SDL_DestroyTexture(battery_icon_texture);
-    SDL_DestroyTexture(lightning_icon_texture);
-
-    SDL_DestroyRenderer(renderer);
-    SDL_DestroyWindow(window);
-    SDL_Quit();
-
-    if(brightness_file >= 0) {
-        char buf[256] = "";
-        int len = snprintf(buf, 256, "%i", max_brightness);
-        write(brightness_file, buf, len < 256 ? len : 256);
-        close(brightness_file);
-    }
+    backend.destroy(&backend);
+
+    LOG("INFO", "%u main and %u sampler wakeups, %u suspends, %.3f wakeups/s",
+        wakeups, sampler_wakeups(&sampler), can_suspend ? suspend.count : 0,
+        wakeup_rate(&total_rate, wakeups + sampler_wakeups(&sampler)));
+    sampler_stop(&sampler);
+
+    input_close(&input);
+    close(screen_timer);
+    close(blink_timer);
+    close(unplug_timer);
+    close(pump_timer);
+    close(oled_timer);
+    close(plug_timer);
+    rtc_alarm_close(&rtc_alarm);
+    if (can_suspend)
+        suspend_destroy(&suspend);
+    backlight_set(&backlight, backlight.max);
+    backlight_close(&backlight, &loop);
+    close(signal_fd);
+    event_loop_destroy(&loop);
 
     return retreason;
 }
@@ -1,18 +1,7 @@
 #include "draw.h"
 
-#define FETCH_PIXEL(s, x, y) ((Uint32*)((Uint8*)(s)->pixels + ((y) * (s)->w + (x)) * ((s)->format->BytesPerPixel)))
-
-static inline void flip_coords(int* x, int* y, int* x1, int* y1)
-{
-    int tmpx = *x;
-    int tmpy = *y;
-
-    *x = *x1;
-    *y = *y1;
-
-    *x1 = tmpx;
-    *y1 = tmpy;
-}
+#include <stdlib.h>
+#include <string.h>
 
 SDL_Rect* make_battery_rect(int w, int h, SDL_Rect* bat_rect)
 {
@@ -28,14 +17,44 @@ SDL_Rect* make_battery_rect(int w, int h, SDL_Rect* bat_rect)
     return bat_rect;
 }
 
-SDL_Surface* make_battery_icon(SDL_Rect bat_rect, int w, int h)
+SDL_Rect* make_gauge_rect(SDL_Rect bat_rect, int percent, SDL_Rect* gauge_rect)
+{
+    gauge_rect->x = bat_rect.x + bat_rect.h * 0.05;
+    gauge_rect->y = bat_rect.y + (bat_rect.h * 0.90) * (100 - percent) / 100.0f + bat_rect.h * 0.05;
+    gauge_rect->h = bat_rect.h - gauge_rect->y + bat_rect.y - bat_rect.h * 0.05;
+    gauge_rect->w = bat_rect.w - bat_rect.h * 0.1;
+    return gauge_rect;
+}
+
+SDL_Color gauge_color(int percent)
+{
+    SDL_Color color = { (100 - percent) / 100.0f * 255, percent / 100.0f * 255, 0, 255 };
+    return color;
+}
+
+SDL_Rect* make_battery_bounds(SDL_Rect bat_rect, SDL_Rect* bounds)
+{
+    /* the terminal sits on top of the body, see make_battery_icon */
+    int terminal = bat_rect.h * 0.05 + 1;
+    bounds->x = bat_rect.x;
+    bounds->y = bat_rect.y - terminal;
+    bounds->w = bat_rect.w;
+    bounds->h = bat_rect.h + terminal;
+    return bounds;
+}
+
+SDL_Surface* make_battery_icon(SDL_Rect bat_rect, Uint32 format)
 {
-    SDL_Surface* surf;
-#if SDL_BYTEORDER == SDL_BIG_ENDIAN
-    surf = SDL_CreateRGBSurface(0, w, h, 32, 0xff000000, 0x00ff0000, 0x0000ff00, 0x000000ff);
-#else
-    surf = SDL_CreateRGBSurface(0, w, h, 32, 0x000000ff, 0x0000ff00, 0x00ff0000, 0xff000000);
-#endif
+    SDL_Rect bounds;
+    make_battery_bounds(bat_rect, &bounds);
+
+    SDL_Surface* surf = SDL_CreateRGBSurfaceWithFormat(0, bounds.w, bounds.h, SDL_BITSPERPIXEL(format), format);
+    if (!surf)
+        return NULL;
+
+    /* draw relative to the icon's own origin */
+    bat_rect.x -= bounds.x;
+    bat_rect.y -= bounds.y;
 
     SDL_FillRect(surf, NULL, SDL_MapRGBA(surf->format, 0, 0, 0, 255));
     SDL_FillRect(surf, &bat_rect, SDL_MapRGBA(surf->format, 255, 255, 255, 255));
@@ -57,32 +76,35 @@ SDL_Surface* make_battery_icon(SDL_Rect bat_rect, int w, int h)
     return surf;
 }
 
-SDL_Surface* make_lightning_icon(int w, int h)
+SDL_Point* make_lightning_outline(int w, int h, SDL_Point* outline)
 {
-    SDL_Surface* surf;
-#if SDL_BYTEORDER == SDL_BIG_ENDIAN
-    surf = SDL_CreateRGBSurface(0, w, h, 32, 0xff000000, 0x00ff0000, 0x0000ff00, 0x000000ff);
-#else
-    surf = SDL_CreateRGBSurface(0, w, h, 32, 0x000000ff, 0x0000ff00, 0x00ff0000, 0xff000000);
-#endif
     int offset_x = 0;
     if (w > h) {
         offset_x = (w - h / 2) / 2;
         w = h / 2;
     }
 
+    outline[0] = (SDL_Point) { offset_x + w * 0.4, 0 };
+    outline[1] = (SDL_Point) { offset_x + w * 0.2, h / 2 };
+    outline[2] = (SDL_Point) { offset_x + w * 0.4, h / 2 };
+    outline[3] = (SDL_Point) { offset_x + w * 0.3, h };
+    outline[4] = (SDL_Point) { offset_x + w * 0.8, h / 3 };
+    outline[5] = (SDL_Point) { offset_x + w * 0.6, h / 3 };
+    outline[6] = (SDL_Point) { offset_x + w * 0.8, 0 };
+    return outline;
+}
+
+SDL_Surface* make_lightning_icon(int w, int h, Uint32 format)
+{
+    SDL_Surface* surf = SDL_CreateRGBSurfaceWithFormat(0, w, h, SDL_BITSPERPIXEL(format), format);
+    if (!surf)
+        return NULL;
+
     SDL_FillRect(surf, NULL, SDL_MapRGBA(surf->format, 0, 0, 0, 0));
-    SDL_Point outline[7] = {
-        { offset_x + w * 0.4, 0 },
-        { offset_x + w * 0.2, h / 2 },
-        { offset_x + w * 0.4, h / 2 },
-        { offset_x + w * 0.3, h },
-        { offset_x + w * 0.8, h / 3 },
-        { offset_x + w * 0.6, h / 3 },
-        { offset_x + w * 0.8, 0 },
-    };
-
-    fill_polygon(surf, SDL_MapRGBA(surf->format, 255, 255, 255, 255), outline, 7);
+    SDL_Point outline[LIGHTNING_POINTS];
+    make_lightning_outline(w, h, outline);
+
+    fill_polygon(surf, SDL_MapRGBA(surf->format, 255, 255, 255, 255), outline, LIGHTNING_POINTS);
     return surf;
 }
 
@@ -100,85 +122,188 @@ void move_oled_rect(int w, int h, SDL_Rect* rect)
     rect->y = rand() % (h / 2 - rect->h + 1);
 }
 
-int draw_line(SDL_Surface* surf, Uint32 c, int x, int y, int x1, int y1)
+static inline void put_pixel(SDL_Surface* surf, Uint32 c, int x, int y)
 {
-    if ((x > x1 && y >= y1) || (y > y1 && x < x1)) {
-        flip_coords(&x, &y, &x1, &y1);
+    if (x < 0 || y < 0 || x >= surf->w || y >= surf->h)
+        return;
+
+    Uint8* pix = (Uint8*)surf->pixels + y * surf->pitch + x * surf->format->BytesPerPixel;
+    switch (surf->format->BytesPerPixel) {
+    case 4:
+        *(Uint32*)pix = c;
+        break;
+    case 2:
+        *(Uint16*)pix = c;
+        break;
+    case 1:
+        *pix = c;
+        break;
+    default:
+        SDL_FillRect(surf, &(SDL_Rect) { x, y, 1, 1 }, c);
+        break;
     }
-    double cur_x = x;
-    double cur_y = y;
+}
 
-    Uint32* cur_pix = NULL;
+/* write pixels [x, x1) of row y, the caller clips */
+static inline void fill_span(SDL_Surface* surf, Uint32 c, int y, int x, int x1)
+{
+    Uint8* row = (Uint8*)surf->pixels + y * surf->pitch;
 
-    int steps;
-    if (x1 - x > y1 - y) {
-        steps = abs(x1 - x);
-    } else {
-        steps = abs(y1 - y);
+    switch (surf->format->BytesPerPixel) {
+    case 4:
+        SDL_memset4(row + x * 4, c, x1 - x);
+        break;
+    case 2: {
+        Uint16* pix = (Uint16*)row + x;
+        for (int i = x; i < x1; ++i)
+            *pix++ = c;
+        break;
     }
-    double change_x = (x1 - x) / (double)steps;
-    double change_y = (y1 - y) / (double)steps;
-    for (int i = 0; i < steps; ++i) {
-        cur_pix = FETCH_PIXEL(surf, (int)cur_x, (int)cur_y);
-        (*cur_pix) = c;
-
-        cur_x += change_x;
-        cur_y += change_y;
+    case 1:
+        memset(row + x, c, x1 - x);
+        break;
+    default:
+        SDL_FillRect(surf, &(SDL_Rect) { x, y, x1 - x, 1 }, c);
+        break;
+    }
+}
+
+int draw_line(SDL_Surface* surf, Uint32 c, int x, int y, int x1, int y1)
+{
+    /* Bresenham, symmetric in both directions so no endpoint swapping */
+    int dx = abs(x1 - x);
+    int dy = -abs(y1 - y);
+    int sx = x < x1 ? 1 : -1;
+    int sy = y < y1 ? 1 : -1;
+    int err = dx + dy;
+
+    for (;;) {
+        put_pixel(surf, c, x, y);
+        if (x == x1 && y == y1)
+            break;
+        int e2 = 2 * err;
+        if (e2 >= dy) {
+            err += dy;
+            x += sx;
+        }
+        if (e2 <= dx) {
+            err += dx;
+            y += sy;
+        }
     }
     return 0;
 }
 
+/* 16.16 fixed point */
+#define FIX_SHIFT 16
+#define FIX_ONE (1 << FIX_SHIFT)
+#define FIX_HALF (FIX_ONE / 2)
+
+struct edge {
+    int y_top; /* first scanline the edge covers */
+    int y_bottom; /* first scanline it no longer covers */
+    Sint32 x; /* x at the centre of the current scanline */
+    Sint32 dxdy; /* change of x per scanline */
+};
+
+/* first pixel whose centre lies at or right of fixed point x */
+static inline int span_start(Sint32 x)
+{
+    return (x - FIX_HALF + FIX_ONE - 1) >> FIX_SHIFT;
+}
+
 int fill_polygon(SDL_Surface* surf, Uint32 color, SDL_Point* points, int numpoints)
 {
-    int max_x = -1;
-    int max_y = -1;
+    if (numpoints < 3)
+        return 1;
+
+    struct edge* edges = SDL_malloc(numpoints * (sizeof(struct edge) + sizeof(struct edge*)));
+    if (!edges)
+        return 1;
+    struct edge** active = (struct edge**)(edges + numpoints);
+    int num_edges = 0;
+    int num_active = 0;
     int min_y = surf->h;
-    int min_x = surf->w;
+    int max_y = 0;
 
+    /* edge table, sorted by the scanline the edge starts on */
     for (int l = 0; l < numpoints; ++l) {
-        if (points[l].x > max_x)
-            max_x = points[l].x;
-        if (points[l].x < min_x)
-            min_x = points[l].x;
-        if (points[l].y > max_y)
-            max_y = points[l].y;
-        if (points[l].y < min_y)
-            min_y = points[l].y;
-
-        if (l != numpoints - 1) {
-            if (draw_line(surf, color, points[l].x, points[l].y, points[l + 1].x, points[l + 1].y))
-                return 1;
-        } else {
-            if (draw_line(surf, color, points[l].x, points[l].y, points[0].x, points[0].y))
-                return 1;
+        SDL_Point a = points[l];
+        SDL_Point b = points[(l + 1) % numpoints];
+
+        if (a.y == b.y)
+            continue; /* horizontal edges are covered by the spans */
+        if (a.y > b.y) {
+            SDL_Point tmp = a;
+            a = b;
+            b = tmp;
         }
+
+        struct edge e;
+        e.y_top = a.y;
+        e.y_bottom = b.y;
+        e.dxdy = (Sint32)(((Sint64)(b.x - a.x) << FIX_SHIFT) / (b.y - a.y));
+        e.x = (a.x << FIX_SHIFT) + e.dxdy / 2;
+
+        int i = num_edges++;
+        while (i > 0 && edges[i - 1].y_top > e.y_top) {
+            edges[i] = edges[i - 1];
+            --i;
+        }
+        edges[i] = e;
+
+        if (e.y_top < min_y)
+            min_y = e.y_top;
+        if (e.y_bottom > max_y)
+            max_y = e.y_bottom;
     }
-    Uint32* pix;
+
+    if (max_y > surf->h)
+        max_y = surf->h;
+
+    int next_edge = 0;
     for (int y = min_y; y < max_y; ++y) {
-        int flip = 0;
-        for (int x = min_x; x < max_x; ++x) {
-            pix = FETCH_PIXEL(surf, x, y);
-            if (*pix == color) {
-                flip += 1;
-                pix = FETCH_PIXEL(surf, ++x, y);
-                while (*pix == color) {
-                    pix = FETCH_PIXEL(surf, ++x, y);
-                }
-                int dx = x;
-                while (*pix != color) {
-                    if (dx >= max_x)
-                        break;
-                    pix = FETCH_PIXEL(surf, ++dx, y);
-                }
-                if (dx >= max_x)
-                    break;
-                else
-                    pix = FETCH_PIXEL(surf, x, y);
+        /* retire finished edges, step the others to this scanline */
+        int kept = 0;
+        for (int i = 0; i < num_active; ++i) {
+            if (active[i]->y_bottom > y)
+                active[kept++] = active[i];
+        }
+        num_active = kept;
+
+        while (next_edge < num_edges && edges[next_edge].y_top <= y) {
+            struct edge* e = &edges[next_edge++];
+            active[num_active++] = e;
+        }
+
+        /* keep the active edges ordered by x, they rarely swap */
+        for (int i = 1; i < num_active; ++i) {
+            struct edge* e = active[i];
+            int j = i;
+            while (j > 0 && active[j - 1]->x > e->x) {
+                active[j] = active[j - 1];
+                --j;
             }
+            active[j] = e;
+        }
 
-            if (flip % 2 != 0)
-                *pix = color;
+        if (y >= 0) {
+            for (int i = 0; i + 1 < num_active; i += 2) {
+                int x0 = span_start(active[i]->x);
+                int x1 = span_start(active[i + 1]->x);
+                if (x0 < 0)
+                    x0 = 0;
+                if (x1 > surf->w)
+                    x1 = surf->w;
+                if (x0 < x1)
+                    fill_span(surf, color, y, x0, x1);
+            }
         }
+
+        for (int i = 0; i < num_active; ++i)
+            active[i]->x += active[i]->dxdy;
     }
+
+    SDL_free(edges);
     return 0;
 }
@@ -15,20 +15,37 @@
 */
 int draw_line(SDL_Surface* surf, Uint32 c, int x, int y, int x1, int y1);
 
+/* pixel format of the icons, the 16 bit one holds their colors exactly */
+#define ICON_FORMAT SDL_PIXELFORMAT_RGBA32
+#define ICON_FORMAT_16BIT SDL_PIXELFORMAT_RGBA4444
+
 /**
-  create a battery icon to fit within a specific area
-  @param bat_rect the SDL_Rect the battery must fit in
-  @returns returns a battery icon, its surface's width and height are equal to bat_rect
+  create a battery icon for a battery body
+  @param bat_rect the battery body, see make_battery_rect
+  @param format the pixel format of the icon, ICON_FORMAT or ICON_FORMAT_16BIT
+  @returns returns a battery icon, its surface covers make_battery_bounds of bat_rect
 */
-SDL_Surface* make_battery_icon(SDL_Rect bat_rect, int w, int h);
+SDL_Surface* make_battery_icon(SDL_Rect bat_rect, Uint32 format);
 
 /**
   create a lightning bolt icon, the icon will fit within w and h without being stretched
   @param w the width the bolt must fit in
   @param h the height the bolt must fit in
+  @param format the pixel format of the icon, ICON_FORMAT or ICON_FORMAT_16BIT
   @returns returns a lightning icon, its surface's width and height are equal to w and h
 */
-SDL_Surface* make_lightning_icon(int w, int h);
+SDL_Surface* make_lightning_icon(int w, int h, Uint32 format);
+
+#define LIGHTNING_POINTS 7
+
+/**
+  get the outline of the lightning bolt that make_lightning_icon fills
+  @param w the width the bolt must fit in
+  @param h the height the bolt must fit in
+  @param outline array of LIGHTNING_POINTS points to fill
+  @returns returns outline
+*/
+SDL_Point* make_lightning_outline(int w, int h, SDL_Point* outline);
 
 /**
   get the rectangle for the batteries 'body' that fits within specific bounds
@@ -39,6 +56,29 @@ SDL_Surface* make_lightning_icon(int w, int h);
 */
 SDL_Rect* make_battery_rect(int w, int h, SDL_Rect* bat_rect);
 
+/**
+  get the rectangle the charge level fills inside the battery
+  @param bat_rect the battery body, see make_battery_rect
+  @param percent the charge level, 0 to 100
+  @param gauge_rect a pointer to the rectangle to fill
+  @returns returns gauge_rect
+*/
+SDL_Rect* make_gauge_rect(SDL_Rect bat_rect, int percent, SDL_Rect* gauge_rect);
+
+/**
+  get the color of the charge level, from red when empty to green when full
+  @param percent the charge level, 0 to 100
+*/
+SDL_Color gauge_color(int percent);
+
+/**
+  get the area the battery icon draws on, its body and the terminal on top
+  @param bat_rect the battery body, see make_battery_rect
+  @param bounds a pointer to the rectangle to fill
+  @returns returns bounds
+*/
+SDL_Rect* make_battery_bounds(SDL_Rect bat_rect, SDL_Rect* bounds);
+
 /**
   create a small square, that will move around the screen, to prevent burn-in's
   @param h the height of the screen
@@ -0,0 +1,131 @@
+#include "eventloop.h"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include "log.h"
+
+int event_loop_init(struct event_loop* loop)
+{
+    for (int i = 0; i < EVENT_LOOP_MAX_SOURCES; ++i)
+        loop->sources[i].fd = -1;
+
+    loop->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (loop->epoll_fd < 0) {
+        ERROR("can not create epoll instance: %s", strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+void event_loop_destroy(struct event_loop* loop)
+{
+    if (loop->epoll_fd >= 0)
+        close(loop->epoll_fd);
+    loop->epoll_fd = -1;
+}
+
+int event_loop_add(struct event_loop* loop, int fd, event_handler handler, void* data)
+{
+    struct event_source* source = NULL;
+
+    for (int i = 0; i < EVENT_LOOP_MAX_SOURCES; ++i) {
+        if (loop->sources[i].fd < 0) {
+            source = &loop->sources[i];
+            break;
+        }
+    }
+    if (!source) {
+        ERROR("too many event sources");
+        return -1;
+    }
+
+    struct epoll_event ev = { .events = EPOLLIN, .data.ptr = source };
+    if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        ERROR("can not watch fd %i: %s", fd, strerror(errno));
+        return -1;
+    }
+
+    source->fd = fd;
+    source->handler = handler;
+    source->data = data;
+    return 0;
+}
+
+void event_loop_remove(struct event_loop* loop, int fd)
+{
+    for (int i = 0; i < EVENT_LOOP_MAX_SOURCES; ++i) {
+        if (loop->sources[i].fd == fd) {
+            epoll_ctl(loop->epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+            loop->sources[i].fd = -1;
+        }
+    }
+}
+
+int event_loop_dispatch(struct event_loop* loop, int timeout_ms)
+{
+    struct epoll_event events[EVENT_LOOP_MAX_SOURCES];
+
+    int n = epoll_wait(loop->epoll_fd, events, EVENT_LOOP_MAX_SOURCES, timeout_ms);
+    if (n < 0) {
+        if (errno == EINTR)
+            return 0;
+        ERROR("epoll_wait failed: %s", strerror(errno));
+        return -1;
+    }
+
+    for (int i = 0; i < n; ++i) {
+        struct event_source* source = events[i].data.ptr;
+        /* an earlier handler may have removed this source */
+        if (source->fd >= 0)
+            source->handler(source->fd, events[i].events, source->data);
+    }
+    return n;
+}
+
+int timer_new(void)
+{
+    int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (fd < 0) {
+        ERROR("can not create timer: %s", strerror(errno));
+    }
+    return fd;
+}
+
+void timer_arm(int fd, unsigned int ms, bool periodic)
+{
+    struct itimerspec spec = { 0 };
+
+    spec.it_value.tv_sec = ms / 1000;
+    spec.it_value.tv_nsec = (ms % 1000) * 1000000L;
+    if (periodic)
+        spec.it_interval = spec.it_value;
+
+    timerfd_settime(fd, 0, &spec, NULL);
+}
+
+uint64_t timer_ack(int fd)
+{
+    uint64_t expirations = 0;
+    if (read(fd, &expirations, sizeof(expirations)) != sizeof(expirations))
+        return 0;
+    return expirations;
+}
+
+int signal_fd_new(const sigset_t* mask)
+{
+    if (sigprocmask(SIG_BLOCK, mask, NULL) < 0) {
+        ERROR("can not block signals: %s", strerror(errno));
+        return -1;
+    }
+
+    int fd = signalfd(-1, mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (fd < 0) {
+        ERROR("can not create signalfd: %s", strerror(errno));
+    }
+    return fd;
+}
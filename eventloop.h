@@ -0,0 +1,75 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <signal.h>
+
+#define EVENT_LOOP_MAX_SOURCES 32
+
+typedef void (*event_handler)(int fd, uint32_t events, void* data);
+
+struct event_source {
+    int fd;
+    event_handler handler;
+    void* data;
+};
+
+struct event_loop {
+    int epoll_fd;
+    struct event_source sources[EVENT_LOOP_MAX_SOURCES];
+};
+
+/**
+  set up an empty event loop
+  @returns 0 on success, -1 on failure
+*/
+int event_loop_init(struct event_loop* loop);
+
+/**
+  close the epoll instance, the fds of the sources are left to their owners
+*/
+void event_loop_destroy(struct event_loop* loop);
+
+/**
+  watch a fd for input
+  @param handler called from event_loop_dispatch when fd becomes readable
+  @returns 0 on success, -1 on failure
+*/
+int event_loop_add(struct event_loop* loop, int fd, event_handler handler, void* data);
+
+/**
+  stop watching a fd
+*/
+void event_loop_remove(struct event_loop* loop, int fd);
+
+/**
+  wait for the next event and run the handlers of all ready sources
+  @param timeout_ms maximum time to wait, -1 waits forever
+  @returns the number of handled sources, -1 on error
+*/
+int event_loop_dispatch(struct event_loop* loop, int timeout_ms);
+
+/**
+  create a disarmed monotonic timerfd
+  @returns the timer fd or -1 on failure
+*/
+int timer_new(void);
+
+/**
+  (re)arm a timer
+  @param ms time until the first expiry, 0 disarms the timer
+  @param periodic keep firing every ms milliseconds
+*/
+void timer_arm(int fd, unsigned int ms, bool periodic);
+
+/**
+  consume the expirations of a timer
+  @returns the number of expirations since the last call
+*/
+uint64_t timer_ack(int fd);
+
+/**
+  block the signals in mask and return a signalfd receiving them instead
+  @returns the signal fd or -1 on failure
+*/
+int signal_fd_new(const sigset_t* mask);
@@ -0,0 +1,112 @@
+#include "font.h"
+
+#include <string.h>
+
+static const char glyph_chars[] = "0123456789%:";
+
+#define GLYPH_COUNT (sizeof(glyph_chars) - 1)
+
+/* columns between glyphs in the atlas, so filtering never bleeds */
+#define ATLAS_GAP 1
+
+/* a row per byte, the leftmost pixel in bit 4 */
+static const Uint8 glyphs[GLYPH_COUNT][FONT_GLYPH_H] = {
+    { 0x0e, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0e }, /* 0 */
+    { 0x04, 0x0c, 0x04, 0x04, 0x04, 0x04, 0x0e }, /* 1 */
+    { 0x0e, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1f }, /* 2 */
+    { 0x1f, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0e }, /* 3 */
+    { 0x02, 0x06, 0x0a, 0x12, 0x1f, 0x02, 0x02 }, /* 4 */
+    { 0x1f, 0x10, 0x1e, 0x01, 0x01, 0x11, 0x0e }, /* 5 */
+    { 0x06, 0x08, 0x10, 0x1e, 0x11, 0x11, 0x0e }, /* 6 */
+    { 0x1f, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08 }, /* 7 */
+    { 0x0e, 0x11, 0x11, 0x0e, 0x11, 0x11, 0x0e }, /* 8 */
+    { 0x0e, 0x11, 0x11, 0x0f, 0x01, 0x02, 0x0c }, /* 9 */
+    { 0x18, 0x19, 0x02, 0x04, 0x08, 0x13, 0x03 }, /* % */
+    { 0x00, 0x0c, 0x0c, 0x00, 0x0c, 0x0c, 0x00 }, /* : */
+};
+
+#define ATLAS_W (GLYPH_COUNT * (FONT_GLYPH_W + ATLAS_GAP))
+#define ATLAS_H FONT_GLYPH_H
+
+/* glyphs and the gap after all but the last */
+#define ADVANCE (FONT_GLYPH_W + 1)
+
+static int glyph_index(char c)
+{
+    const char* found = c ? strchr(glyph_chars, c) : NULL;
+    return found ? found - glyph_chars : -1;
+}
+
+SDL_Surface* font_atlas(Uint32 format)
+{
+    SDL_Surface* surf = SDL_CreateRGBSurfaceWithFormat(0, ATLAS_W, ATLAS_H, SDL_BITSPERPIXEL(format), format);
+    if (!surf)
+        return NULL;
+
+    const Uint32 ink = SDL_MapRGBA(surf->format, 255, 255, 255, 255);
+    SDL_FillRect(surf, NULL, SDL_MapRGBA(surf->format, 0, 0, 0, 0));
+    for (size_t g = 0; g < GLYPH_COUNT; ++g) {
+        for (int y = 0; y < FONT_GLYPH_H; ++y) {
+            for (int x = 0; x < FONT_GLYPH_W; ++x) {
+                if (glyphs[g][y] & (0x10 >> x)) {
+                    SDL_Rect pixel = { g * (FONT_GLYPH_W + ATLAS_GAP) + x, y, 1, 1 };
+                    SDL_FillRect(surf, &pixel, ink);
+                }
+            }
+        }
+    }
+    return surf;
+}
+
+int font_text_width(const char* text, int scale)
+{
+    int glyphs = 0;
+
+    for (; *text && glyphs < FONT_MAX_TEXT; ++text) {
+        if (glyph_index(*text) >= 0)
+            ++glyphs;
+    }
+    return glyphs ? (glyphs * ADVANCE - 1) * scale : 0;
+}
+
+int font_layout(const char* text, int x, int y, int scale, struct font_quad* quads)
+{
+    int count = 0;
+
+    for (; *text && count < FONT_MAX_TEXT; ++text) {
+        const int g = glyph_index(*text);
+        if (g < 0)
+            continue;
+        quads[count].src = (SDL_Rect) { g * (FONT_GLYPH_W + ATLAS_GAP), 0, FONT_GLYPH_W, FONT_GLYPH_H };
+        quads[count].dst = (SDL_Rect) { x, y, FONT_GLYPH_W * scale, FONT_GLYPH_H * scale };
+        x += ADVANCE * scale;
+        ++count;
+    }
+    return count;
+}
+
+void font_batch_set(struct font_batch* batch, const char* text, int x, int y, int scale, SDL_Color color)
+{
+    struct font_quad quads[FONT_MAX_TEXT];
+
+    batch->glyphs = font_layout(text, x - font_text_width(text, scale) / 2, y, scale, quads);
+    for (int i = 0; i < batch->glyphs; ++i) {
+        const SDL_Rect s = quads[i].src;
+        const SDL_Rect d = quads[i].dst;
+        font_vertex* v = &batch->vertices[i * 4];
+        int* index = &batch->indices[i * 6];
+
+        /* clockwise from the top left */
+        v[0] = (font_vertex) { { d.x, d.y }, color, { (float)s.x / ATLAS_W, 0 } };
+        v[1] = (font_vertex) { { d.x + d.w, d.y }, color, { (float)(s.x + s.w) / ATLAS_W, 0 } };
+        v[2] = (font_vertex) { { d.x + d.w, d.y + d.h }, color, { (float)(s.x + s.w) / ATLAS_W, 1 } };
+        v[3] = (font_vertex) { { d.x, d.y + d.h }, color, { (float)s.x / ATLAS_W, 1 } };
+
+        index[0] = i * 4;
+        index[1] = i * 4 + 1;
+        index[2] = i * 4 + 2;
+        index[3] = i * 4;
+        index[4] = i * 4 + 2;
+        index[5] = i * 4 + 3;
+    }
+}
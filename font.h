@@ -0,0 +1,77 @@
+#ifndef FONT_H
+#define FONT_H
+
+#include <SDL2/SDL.h>
+
+/* size of a glyph in font pixels, text is drawn at whole multiples of it */
+#define FONT_GLYPH_W 5
+#define FONT_GLYPH_H 7
+
+/* the longest string one batch holds */
+#define FONT_MAX_TEXT 8
+
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+typedef SDL_Vertex font_vertex;
+#else
+/* laid out like SDL_Vertex, which SDL only has since 2.0.18 */
+typedef struct {
+    SDL_FPoint position;
+    SDL_Color color;
+    SDL_FPoint tex_coord;
+} font_vertex;
+#endif
+
+/* where a glyph comes from in the atlas and where it goes on screen */
+struct font_quad {
+    SDL_Rect src;
+    SDL_Rect dst;
+};
+
+/**
+  A string ready for SDL_RenderGeometry or glDrawElements, with room for FONT_MAX_TEXT glyphs so
+  setting the text never allocates.
+*/
+struct font_batch {
+    font_vertex vertices[FONT_MAX_TEXT * 4];
+    int indices[FONT_MAX_TEXT * 6];
+    int glyphs;
+};
+
+/**
+  create the atlas all glyphs are drawn from, white on transparent
+  @param format the pixel format of the atlas, ICON_FORMAT or ICON_FORMAT_16BIT
+  @returns the atlas surface or NULL on failure
+*/
+SDL_Surface* font_atlas(Uint32 format);
+
+/**
+  get the width of a string
+  @param text digits, '%' and ':', other characters are skipped
+  @param scale screen pixels per font pixel
+  @returns the width in screen pixels
+*/
+int font_text_width(const char* text, int scale);
+
+/**
+  place the glyphs of a string
+  @param text digits, '%' and ':', other characters are skipped
+  @param x left edge of the text
+  @param y top edge of the text
+  @param scale screen pixels per font pixel
+  @param quads filled with up to FONT_MAX_TEXT glyphs
+  @returns the number of glyphs placed
+*/
+int font_layout(const char* text, int x, int y, int scale, struct font_quad* quads);
+
+/**
+  fill a batch with a string, the text is centered on x
+  @param batch the batch to fill
+  @param text digits, '%' and ':', other characters are skipped
+  @param x center of the text
+  @param y top edge of the text
+  @param scale screen pixels per font pixel
+  @param color the color of the text
+*/
+void font_batch_set(struct font_batch* batch, const char* text, int x, int y, int scale, SDL_Color color);
+
+#endif
@@ -0,0 +1,139 @@
+#include "gauge.h"
+
+#include "draw.h"
+#include "log.h"
+
+/* texture size every GLES2 implementation we run on can handle */
+#define GAUGE_FALLBACK_TEXTURE_SIZE 2048
+
+static SDL_Rect slot_rect(const struct gauge_atlas* atlas, int slot)
+{
+    SDL_Rect rect = { slot * atlas->bounds.w, 0, atlas->bounds.w, atlas->bounds.h };
+    return rect;
+}
+
+/* the same draw calls a frame used to make, relative to dst */
+static void draw_gauge(const struct gauge_atlas* atlas, SDL_Renderer* renderer,
+    int percent, const SDL_Rect* dst)
+{
+    SDL_Rect fill;
+    SDL_Color color = gauge_color(percent);
+
+    SDL_RenderCopy(renderer, atlas->battery_icon, NULL, dst);
+
+    make_gauge_rect(atlas->battery_rect, percent, &fill);
+    fill.x += dst->x - atlas->bounds.x;
+    fill.y += dst->y - atlas->bounds.y;
+    SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, color.a);
+    SDL_RenderFillRect(renderer, &fill);
+}
+
+void gauge_atlas_init(struct gauge_atlas* atlas, SDL_Renderer* renderer,
+    SDL_Texture* battery_icon, SDL_Rect battery_rect)
+{
+    SDL_RendererInfo info;
+
+    atlas->texture = NULL;
+    atlas->battery_icon = battery_icon;
+    atlas->battery_rect = battery_rect;
+    make_battery_bounds(battery_rect, &atlas->bounds);
+    atlas->slots = 0;
+    atlas->clock = 0;
+
+    if (!SDL_RenderTargetSupported(renderer)) {
+        LOG("INFO", "no render targets, drawing the gauge directly");
+        return;
+    }
+
+    int max_w = GAUGE_FALLBACK_TEXTURE_SIZE;
+    int max_h = GAUGE_FALLBACK_TEXTURE_SIZE;
+    if (SDL_GetRendererInfo(renderer, &info) == 0 && info.max_texture_width > 0) {
+        max_w = info.max_texture_width;
+        max_h = info.max_texture_height;
+    }
+
+    if (atlas->bounds.w <= 0 || atlas->bounds.h > max_h)
+        return;
+    atlas->slots = max_w / atlas->bounds.w;
+    if (atlas->slots > GAUGE_SLOTS)
+        atlas->slots = GAUGE_SLOTS;
+    if (atlas->slots == 0)
+        return;
+
+    atlas->texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET,
+        atlas->slots * atlas->bounds.w, atlas->bounds.h);
+    if (!atlas->texture) {
+        LOG("WARN", "can not create gauge atlas: %s", SDL_GetError());
+        atlas->slots = 0;
+        return;
+    }
+    SDL_SetTextureBlendMode(atlas->texture, SDL_BLENDMODE_NONE);
+
+    gauge_atlas_invalidate(atlas);
+    LOG("INFO", "gauge atlas with %i slots of %ix%i", atlas->slots, atlas->bounds.w, atlas->bounds.h);
+}
+
+static int bake(struct gauge_atlas* atlas, SDL_Renderer* renderer, int percent)
+{
+    int slot = 0;
+
+    /* least recently used slot, empty ones first */
+    for (int i = 1; i < atlas->slots; ++i) {
+        if (atlas->slot_percent[slot] < 0)
+            break;
+        if (atlas->slot_percent[i] < 0 || atlas->slot_used[i] < atlas->slot_used[slot])
+            slot = i;
+    }
+
+    SDL_Rect dst = slot_rect(atlas, slot);
+    if (SDL_SetRenderTarget(renderer, atlas->texture) != 0) {
+        LOG("WARN", "can not render to gauge atlas: %s", SDL_GetError());
+        return -1;
+    }
+    draw_gauge(atlas, renderer, percent, &dst);
+    SDL_SetRenderTarget(renderer, NULL);
+
+    atlas->slot_percent[slot] = percent;
+    return slot;
+}
+
+void gauge_draw(struct gauge_atlas* atlas, SDL_Renderer* renderer, int percent)
+{
+    int slot = -1;
+
+    if (!atlas->texture) {
+        draw_gauge(atlas, renderer, percent, &atlas->bounds);
+        return;
+    }
+
+    for (int i = 0; i < atlas->slots; ++i) {
+        if (atlas->slot_percent[i] >= 0 && atlas->slot_percent[i] == percent) {
+            slot = i;
+            break;
+        }
+    }
+    if (slot < 0)
+        slot = bake(atlas, renderer, percent);
+    if (slot < 0) {
+        draw_gauge(atlas, renderer, percent, &atlas->bounds);
+        return;
+    }
+
+    atlas->slot_used[slot] = ++atlas->clock;
+    SDL_Rect src = slot_rect(atlas, slot);
+    SDL_RenderCopy(renderer, atlas->texture, &src, &atlas->bounds);
+}
+
+void gauge_atlas_invalidate(struct gauge_atlas* atlas)
+{
+    for (int i = 0; i < atlas->slots; ++i)
+        atlas->slot_percent[i] = -1;
+}
+
+void gauge_atlas_destroy(struct gauge_atlas* atlas)
+{
+    if (atlas->texture)
+        SDL_DestroyTexture(atlas->texture);
+    atlas->texture = NULL;
+    atlas->slots = 0;
+}
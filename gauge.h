@@ -0,0 +1,58 @@
+#ifndef GAUGE_H
+#define GAUGE_H
+
+#include <SDL2/SDL.h>
+#include <stdbool.h>
+
+/* gauge images kept baked at once, enough for a level flickering between two
+   values plus some history, each a battery sized region of the one atlas
+   texture */
+#define GAUGE_SLOTS 4
+
+/**
+  Cache of baked battery gauges, the battery icon with its charge level
+  filled in, in one render target texture. A frame then needs a single copy
+  instead of an icon copy plus a fill.
+*/
+struct gauge_atlas {
+    SDL_Texture* texture; /* NULL if the renderer can not render to textures */
+    SDL_Texture* battery_icon; /* icon texture the gauges are baked from */
+    SDL_Rect battery_rect;
+    SDL_Rect bounds; /* where a gauge goes on screen */
+    int slots;
+    int slot_percent[GAUGE_SLOTS]; /* -1 for an empty slot */
+    Uint32 slot_used[GAUGE_SLOTS];
+    Uint32 clock;
+};
+
+/**
+  set up the atlas, falls back to drawing directly if render targets are missing
+  @param atlas the atlas to initialize
+  @param renderer the renderer the gauges are drawn with
+  @param battery_icon texture made from make_battery_icon
+  @param battery_rect the battery body, see make_battery_rect
+*/
+void gauge_atlas_init(struct gauge_atlas* atlas, SDL_Renderer* renderer,
+    SDL_Texture* battery_icon, SDL_Rect battery_rect);
+
+/**
+  draw the battery with its charge level, baking it first if needed
+  @param atlas the atlas
+  @param renderer the renderer passed to gauge_atlas_init
+  @param percent the charge level, 0 to 100
+*/
+void gauge_draw(struct gauge_atlas* atlas, SDL_Renderer* renderer, int percent);
+
+/**
+  forget the baked gauges, for when the renderer lost the contents of its
+  render targets
+  @param atlas the atlas
+*/
+void gauge_atlas_invalidate(struct gauge_atlas* atlas);
+
+/**
+  free the atlas texture
+*/
+void gauge_atlas_destroy(struct gauge_atlas* atlas);
+
+#endif
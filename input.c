@@ -0,0 +1,125 @@
+#include "input.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/input.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include "log.h"
+
+#define LONG_BITS (sizeof(unsigned long) * 8)
+#define LONGS(bits) (((bits) + LONG_BITS - 1) / LONG_BITS)
+
+static bool test_bit(unsigned int bit, const unsigned long* bits)
+{
+    return bits[bit / LONG_BITS] & (1UL << (bit % LONG_BITS));
+}
+
+/* touchscreens and sensors never get opened, only their keys would wake us */
+static bool has_buttons(int fd)
+{
+    unsigned long types[LONGS(EV_MAX + 1)] = { 0 };
+    unsigned long keys[LONGS(KEY_MAX + 1)] = { 0 };
+
+    if (ioctl(fd, EVIOCGBIT(0, sizeof(types)), types) < 0 || !test_bit(EV_KEY, types))
+        return false;
+    if (ioctl(fd, EVIOCGBIT(EV_KEY, sizeof(keys)), keys) < 0)
+        return false;
+    return test_bit(KEY_POWER, keys) || test_bit(KEY_VOLUMEUP, keys)
+        || test_bit(KEY_VOLUMEDOWN, keys);
+}
+
+/* an unplugged or unbound device would keep epoll ready forever */
+static void drop_device(struct input* input, int fd)
+{
+    for (int i = 0; i < input->count; ++i) {
+        if (input->fds[i] != fd)
+            continue;
+        event_loop_remove(input->loop, fd);
+        close(fd);
+        input->fds[i] = input->fds[--input->count];
+        if (input->count > 0) {
+            LOG("WARN", "input device gone, %i left", input->count);
+        } else {
+            ERROR("last input device gone");
+            input->handler(INPUT_LOST, input->data);
+        }
+        return;
+    }
+}
+
+static void on_input(int fd, uint32_t events, void* data)
+{
+    struct input* input = data;
+    struct input_event ev[16];
+    ssize_t len;
+
+    while ((len = read(fd, ev, sizeof(ev))) > 0) {
+        for (size_t i = 0; i < len / sizeof(ev[0]); ++i) {
+            /* presses only, neither releases nor autorepeat */
+            if (ev[i].type != EV_KEY || ev[i].value != 1)
+                continue;
+            if (ev[i].code == KEY_POWER)
+                input->handler(INPUT_POWER, input->data);
+            else if (ev[i].code == KEY_VOLUMEUP || ev[i].code == KEY_VOLUMEDOWN)
+                input->handler(INPUT_WAKE, input->data);
+        }
+    }
+    if (len == 0 || (len < 0 && errno != EAGAIN) || (events & (EPOLLERR | EPOLLHUP)))
+        drop_device(input, fd);
+}
+
+int input_open(struct input* input, struct event_loop* loop, const char* dir,
+    input_handler handler, void* data)
+{
+    DIR* d = opendir(dir);
+    struct dirent* entry;
+
+    memset(input, 0, sizeof(*input));
+    input->loop = loop;
+    input->handler = handler;
+    input->data = data;
+
+    if (!d) {
+        LOG("WARN", "can not open %s", dir);
+        return 0;
+    }
+
+    while ((entry = readdir(d)) != NULL && input->count < INPUT_MAX_DEVICES) {
+        char path[300];
+        char name[64] = "";
+
+        if (strncmp(entry->d_name, "event", 5) != 0)
+            continue;
+
+        snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+        int fd = open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+        if (fd < 0)
+            continue;
+        if (!has_buttons(fd) || event_loop_add(loop, fd, on_input, input) < 0) {
+            close(fd);
+            continue;
+        }
+        ioctl(fd, EVIOCGNAME(sizeof(name) - 1), name);
+        LOG("INFO", "reading keys from %s (%s)", path, name);
+        input->fds[input->count++] = fd;
+    }
+
+    closedir(d);
+    return input->count;
+}
+
+void input_close(struct input* input)
+{
+    for (int i = 0; i < input->count; ++i) {
+        event_loop_remove(input->loop, input->fds[i]);
+        close(input->fds[i]);
+    }
+    input->count = 0;
+}
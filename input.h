@@ -0,0 +1,39 @@
+#pragma once
+
+#include "eventloop.h"
+
+#define INPUT_DIR "/dev/input"
+#define INPUT_MAX_DEVICES 8
+
+enum input_action {
+    INPUT_WAKE, /* a key that only turns the screen on */
+    INPUT_POWER,
+    INPUT_LOST /* the last device went away, no keys arrive from here on */
+};
+
+typedef void (*input_handler)(enum input_action action, void* data);
+
+/**
+  The evdev devices with a power or volume key, read straight from the event
+  loop without going through SDL's keyboard translation.
+*/
+struct input {
+    int fds[INPUT_MAX_DEVICES];
+    int count;
+    struct event_loop* loop;
+    input_handler handler;
+    void* data;
+};
+
+/**
+  open the event devices in dir that have a power or volume key
+  @param handler called from the event loop for every key press
+  @returns the number of devices opened
+*/
+int input_open(struct input* input, struct event_loop* loop, const char* dir,
+    input_handler handler, void* data);
+
+/**
+  stop watching and close the devices
+*/
+void input_close(struct input* input);
@@ -0,0 +1,224 @@
+#include "render.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "draw.h"
+#include "log.h"
+
+/* size of the test window */
+#define WINDOW_WIDTH 540
+#define WINDOW_HEIGHT 960
+
+static const struct render_backend* const backends[] = {
+    &render_backend_sdl,
+    &render_backend_gles,
+    &render_backend_kms,
+    &render_backend_headless,
+};
+
+bool frame_state_equal(const struct frame_state* a, const struct frame_state* b)
+{
+    return a->percent == b->percent && a->charging == b->charging
+        && a->battery_visible == b->battery_visible && a->minutes_to_full == b->minutes_to_full
+        && a->oled.x == b->oled.x && a->oled.y == b->oled.y;
+}
+
+void render_layout(int w, int h, struct render_layout* layout)
+{
+    make_battery_rect(w, h, &layout->battery);
+
+    layout->charging.x = 0;
+    layout->charging.y = w / 8 * 0.2;
+    layout->charging.w = w / 8;
+    layout->charging.h = w / 8;
+
+    make_oled_rect(h, &layout->oled);
+
+    /* a line is a twentieth of the battery high, with half a line of space */
+    layout->text_scale = SDL_max(1, layout->battery.h / 20 / FONT_GLYPH_H);
+    layout->text.h = FONT_GLYPH_H * layout->text_scale;
+    layout->text.w = layout->battery.w;
+    layout->text.x = layout->battery.x;
+    layout->text.y = layout->battery.y + layout->battery.h + layout->text.h / 2;
+    layout->text_line = layout->text.h * 3 / 2;
+}
+
+void frame_text(const struct frame_state* frame, frame_text_line percent, frame_text_line time)
+{
+    /* the font has no minus, and a level outside of 0-100% is not one to show */
+    if (frame->percent >= 0 && frame->percent <= 100)
+        snprintf(percent, sizeof(frame_text_line), "%i%%", frame->percent);
+    else
+        percent[0] = '\0';
+    if (frame->charging && frame->minutes_to_full >= 0)
+        snprintf(time, sizeof(frame_text_line), "%i:%02i", frame->minutes_to_full / 60, frame->minutes_to_full % 60);
+    else
+        time[0] = '\0';
+}
+
+const struct render_backend* render_backend_find(const char* name)
+{
+    for (size_t i = 0; i < sizeof(backends) / sizeof(backends[0]); ++i) {
+        if (strcmp(backends[i]->name, name) == 0)
+            return backends[i];
+    }
+    return NULL;
+}
+
+SDL_Window* render_create_window(const struct render_options* options, Uint32 flags, int* w, int* h)
+{
+    SDL_Window* window;
+
+    if (SDL_Init(SDL_INIT_EVENTS | SDL_INIT_VIDEO) < 0) {
+        ERROR("failed to init SDL: %s", SDL_GetError());
+        return NULL;
+    }
+
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_ES);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 2);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 0);
+
+    if (options->window) {
+        *w = WINDOW_WIDTH;
+        *h = WINDOW_HEIGHT;
+        LOG("INFO", "creating test window");
+        window = SDL_CreateWindow("Charge - Test Mode",
+            SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
+            *w, *h, flags);
+    } else {
+        SDL_DisplayMode mode = { SDL_PIXELFORMAT_UNKNOWN, 0, 0, 0, 0 };
+        if (SDL_GetDisplayMode(0, 0, &mode) != 0) {
+            ERROR("error fetching display mode: %s", SDL_GetError());
+            return NULL;
+        }
+        *w = mode.w;
+        *h = mode.h;
+        LOG("INFO", "creating window");
+        window = SDL_CreateWindow("Charge",
+            SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
+            0, 0, SDL_WINDOW_FULLSCREEN | SDL_WINDOW_SHOWN | flags);
+    }
+    if (!window) {
+        ERROR("failed to create window: %s", SDL_GetError());
+        return NULL;
+    }
+
+    if (SDL_ShowCursor(SDL_DISABLE) < 0) {
+        LOG("WARNING", "Failed to disable cursor");
+    }
+
+    LOG("INFO", "using video driver: %s", SDL_GetCurrentVideoDriver());
+    return window;
+}
+
+bool soft_painter_init(struct soft_painter* painter, int w, int h, const struct render_options* options)
+{
+    render_layout(w, h, &painter->layout);
+    make_battery_bounds(painter->layout.battery, &painter->battery_bounds);
+    painter->oled = options->oled;
+
+    painter->battery_icon = make_battery_icon(painter->layout.battery, options->icon_format);
+    painter->lightning_icon = make_lightning_icon(painter->layout.charging.w, painter->layout.charging.h,
+        options->icon_format);
+    painter->font = font_atlas(options->icon_format);
+    if (!painter->battery_icon || !painter->lightning_icon || !painter->font) {
+        ERROR("failed to create icons: %s", SDL_GetError());
+        soft_painter_destroy(painter);
+        return false;
+    }
+
+    /* the battery is opaque, copy it instead of blending */
+    SDL_SetSurfaceBlendMode(painter->battery_icon, SDL_BLENDMODE_NONE);
+    return true;
+}
+
+void soft_painter_draw(struct soft_painter* painter, SDL_Surface* target, const struct frame_state* frame)
+{
+    SDL_FillRect(target, NULL, SDL_MapRGB(target->format, 0, 0, 0));
+
+    if (frame->charging) {
+        SDL_Rect dst = painter->layout.charging;
+        SDL_BlitSurface(painter->lightning_icon, NULL, target, &dst);
+    }
+
+    if (frame->battery_visible) {
+        SDL_Rect dst = painter->battery_bounds;
+        SDL_Rect fill;
+        SDL_Color color = gauge_color(frame->percent);
+
+        SDL_BlitSurface(painter->battery_icon, NULL, target, &dst);
+        make_gauge_rect(painter->layout.battery, frame->percent, &fill);
+        SDL_FillRect(target, &fill, SDL_MapRGB(target->format, color.r, color.g, color.b));
+
+        if (painter->oled) {
+            SDL_Rect oled = painter->layout.oled;
+            oled.x = frame->oled.x;
+            oled.y = frame->oled.y;
+            SDL_FillRect(target, &oled, SDL_MapRGB(target->format, 128, 128, 128));
+        }
+
+        frame_text_line lines[2];
+        frame_text(frame, lines[0], lines[1]);
+        for (int l = 0; l < 2; ++l) {
+            struct font_quad quads[FONT_MAX_TEXT];
+            const SDL_Rect* text = &painter->layout.text;
+            const int scale = painter->layout.text_scale;
+            int count = font_layout(lines[l], text->x + (text->w - font_text_width(lines[l], scale)) / 2,
+                text->y + l * painter->layout.text_line, scale, quads);
+
+            for (int i = 0; i < count; ++i)
+                SDL_BlitScaled(painter->font, &quads[i].src, target, &quads[i].dst);
+        }
+    }
+}
+
+void soft_painter_destroy(struct soft_painter* painter)
+{
+    SDL_FreeSurface(painter->battery_icon);
+    SDL_FreeSurface(painter->lightning_icon);
+    SDL_FreeSurface(painter->font);
+    painter->battery_icon = NULL;
+    painter->lightning_icon = NULL;
+    painter->font = NULL;
+}
+
+int render_write_ppm(SDL_Surface* surface, const char* path)
+{
+    FILE* file = fopen(path, "wb");
+    Uint8* row = malloc(surface->w * 3);
+    int ret = 0;
+
+    if (!file || !row) {
+        ERROR("can not write %s", path);
+        if (file)
+            fclose(file);
+        free(row);
+        return -1;
+    }
+
+    SDL_LockSurface(surface);
+    fprintf(file, "P6\n%i %i\n255\n", surface->w, surface->h);
+    for (int y = 0; y < surface->h && ret == 0; ++y) {
+        const Uint8* src = (const Uint8*)surface->pixels + y * surface->pitch;
+        const int bpp = surface->format->BytesPerPixel;
+
+        for (int x = 0; x < surface->w; ++x) {
+            Uint32 pixel = 0;
+            memcpy(&pixel, src + x * bpp, bpp);
+            SDL_GetRGB(pixel, surface->format, &row[x * 3], &row[x * 3 + 1], &row[x * 3 + 2]);
+        }
+        if (fwrite(row, 3, surface->w, file) != (size_t)surface->w)
+            ret = -1;
+    }
+    SDL_UnlockSurface(surface);
+
+    free(row);
+    if (fclose(file) != 0)
+        ret = -1;
+    if (ret < 0) {
+        ERROR("can not write %s", path);
+    }
+    return ret;
+}
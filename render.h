@@ -0,0 +1,134 @@
+#ifndef RENDER_H
+#define RENDER_H
+
+#include <SDL2/SDL.h>
+#include <stdbool.h>
+
+#include "font.h"
+
+/* everything that decides what ends up on screen */
+struct frame_state {
+    int percent;
+    bool charging;
+    bool battery_visible;
+    int minutes_to_full; /* shown while charging, -1 if unknown */
+    SDL_Point oled;
+};
+
+/**
+  compare two frames
+  @returns returns true if both would put the same picture on screen
+*/
+bool frame_state_equal(const struct frame_state* a, const struct frame_state* b);
+
+struct render_options {
+    bool window; /* run in a window instead of fullscreen, where supported */
+    bool oled; /* draw the burn-in prevention square */
+    Uint32 icon_format; /* pixel format for icons drawn on the CPU */
+};
+
+/* where things go on a screen of a given size */
+struct render_layout {
+    SDL_Rect battery; /* the battery body, see make_battery_rect */
+    SDL_Rect charging; /* the lightning bolt */
+    SDL_Rect oled; /* size of the burn-in square, frames carry its position */
+    SDL_Rect text; /* the first line of text under the battery */
+    int text_line; /* distance from one line of text to the next */
+    int text_scale; /* screen pixels per font pixel */
+};
+
+/* a line of text, digits and symbols of the font */
+typedef char frame_text_line[FONT_MAX_TEXT + 1];
+
+/**
+  get the text shown under the battery
+  @param frame the frame to describe
+  @param percent filled with the charge level, empty if it is not within 0-100%
+  @param time filled with the time until full as h:mm, empty if not known
+*/
+void frame_text(const struct frame_state* frame, frame_text_line percent, frame_text_line time);
+
+/**
+  compute the layout for a screen
+  @param w the width of the screen
+  @param h the height of the screen
+  @param layout the layout to fill
+*/
+void render_layout(int w, int h, struct render_layout* layout);
+
+/**
+  A way of putting frames on screen. The tables below are templates, copy one
+  and call init on the copy.
+*/
+struct render_backend {
+    const char* name;
+    bool handles_input; /* key presses arrive as SDL events */
+    bool (*init)(struct render_backend* backend, const struct render_options* options);
+    void (*draw)(struct render_backend* backend, const struct frame_state* frame);
+    void (*destroy)(struct render_backend* backend);
+    int width; /* screen size, valid after init */
+    int height;
+    void* priv;
+};
+
+/* SDL renderer, usually kmsdrm with GLES2 */
+extern const struct render_backend render_backend_sdl;
+/* the shapes drawn by a GLES2 fragment shader from their distance fields */
+extern const struct render_backend render_backend_gles;
+/* DRM dumb buffers drawn on the CPU, no GPU involved */
+extern const struct render_backend render_backend_kms;
+/* an offscreen surface drawn on the CPU, optionally saved after every frame */
+extern const struct render_backend render_backend_headless;
+
+/**
+  look up a backend template by name
+  @returns returns the backend or NULL if there is none of that name
+*/
+const struct render_backend* render_backend_find(const char* name);
+
+/**
+  start SDL video and open the window the SDL based backends draw into, a test
+  window or the whole screen, with the cursor hidden
+  @param options options->window picks the test window
+  @param flags SDL_WindowFlags to add, e.g. SDL_WINDOW_OPENGL
+  @param w filled with the width of the window
+  @param h filled with the height of the window
+  @returns returns the window or NULL on failure, call SDL_Quit either way
+*/
+SDL_Window* render_create_window(const struct render_options* options, Uint32 flags, int* w, int* h);
+
+/**
+  Draws frames on the CPU into an SDL_Surface, for backends without a GPU
+  renderer.
+*/
+struct soft_painter {
+    struct render_layout layout;
+    SDL_Rect battery_bounds;
+    SDL_Surface* battery_icon;
+    SDL_Surface* lightning_icon;
+    SDL_Surface* font;
+    bool oled;
+};
+
+/**
+  create the icons for a screen size
+  @returns returns false if the icons could not be created
+*/
+bool soft_painter_init(struct soft_painter* painter, int w, int h, const struct render_options* options);
+
+/**
+  draw a frame onto target, which must be w by h as passed to soft_painter_init
+*/
+void soft_painter_draw(struct soft_painter* painter, SDL_Surface* target, const struct frame_state* frame);
+
+void soft_painter_destroy(struct soft_painter* painter);
+
+/**
+  save a surface as a binary PPM image
+  @param surface the surface, any pixel format
+  @param path the file to write
+  @returns returns 0 on success, -1 on error
+*/
+int render_write_ppm(SDL_Surface* surface, const char* path);
+
+#endif
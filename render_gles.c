@@ -0,0 +1,463 @@
+#include <SDL2/SDL.h>
+#include <GLES2/gl2.h>
+#include <stdlib.h>
+
+#include "render.h"
+#include "draw.h"
+#include "log.h"
+
+#define STRINGIFY(x) #x
+#define POINTS_STRING(x) STRINGIFY(x)
+#define POINTS POINTS_STRING(LIGHTNING_POINTS)
+
+/* one triangle covering the screen, the fragment shader does the rest */
+static const GLfloat screen_triangle[] = { -1, -1, 3, -1, -1, 3 };
+
+/*
+ * Pixel coordinates do not survive mediump, which on Mali-400 and SGX is fp16:
+ * about a pixel of precision past 1024 and squares overflowing at 65504. So
+ * the vertex stage, which always has highp, moves each group of shapes into its
+ * own frame: centered on the group and in units of its half height. The
+ * fragment stage only sees small numbers and scales distances back to pixels.
+ * A frame is the center and the pixels per unit.
+ */
+static const char vertex_source[] =
+    "uniform vec2 u_screen;\n"
+    "uniform vec3 u_battery_frame;\n"
+    "uniform vec3 u_bolt_frame;\n"
+    "uniform vec3 u_oled_frame;\n"
+    "attribute vec2 a_pos;\n"
+    "varying vec2 v_battery;\n"
+    "varying vec2 v_bolt;\n"
+    "varying vec2 v_oled;\n"
+    "void main() {\n"
+    "    vec2 p = vec2(a_pos.x + 1.0, 1.0 - a_pos.y) * 0.5 * u_screen;\n"
+    "    v_battery = (p - u_battery_frame.xy) / u_battery_frame.z;\n"
+    "    v_bolt = (p - u_bolt_frame.xy) / u_bolt_frame.z;\n"
+    "    v_oled = (p - u_oled_frame.xy) / u_oled_frame.z;\n"
+    "    gl_Position = vec4(a_pos, 0.0, 1.0);\n"
+    "}\n";
+
+/*
+ * Everything is a signed distance, negative inside, turned into coverage over
+ * one pixel. Rects are center and half size in the units of their frame, with y
+ * growing downwards like SDL_Rect. u_units holds the pixels per unit of the
+ * battery, bolt and burn-in square frames.
+ */
+static const char fragment_source[] =
+    "#ifdef GL_FRAGMENT_PRECISION_HIGH\n"
+    "precision highp float;\n"
+    "#else\n"
+    "precision mediump float;\n"
+    "#endif\n"
+    "uniform vec3 u_units;\n"
+    "uniform vec4 u_body;\n"
+    "uniform vec4 u_inner;\n"
+    "uniform vec4 u_terminal;\n"
+    "uniform vec4 u_gauge;\n"
+    "uniform vec3 u_gauge_color;\n"
+    "uniform float u_level;\n"
+    "uniform vec2 u_bolt[" POINTS "];\n"
+    "uniform vec4 u_oled;\n"
+    "uniform bool u_charging;\n"
+    "uniform bool u_visible;\n"
+    "uniform bool u_show_oled;\n"
+    "varying vec2 v_battery;\n"
+    "varying vec2 v_bolt;\n"
+    "varying vec2 v_oled;\n"
+    "\n"
+    "float box(vec2 p, vec4 rect) {\n"
+    "    vec2 d = abs(p - rect.xy) - rect.zw;\n"
+    "    return length(max(d, 0.0)) + min(max(d.x, d.y), 0.0);\n"
+    "}\n"
+    "\n"
+    "float polygon(vec2 p) {\n"
+    "    float d = dot(p - u_bolt[0], p - u_bolt[0]);\n"
+    "    float s = 1.0;\n"
+    "    vec2 b = u_bolt[" POINTS " - 1];\n"
+    "    for (int i = 0; i < " POINTS "; ++i) {\n"
+    "        vec2 a = u_bolt[i];\n"
+    "        vec2 e = b - a;\n"
+    "        vec2 w = p - a;\n"
+    "        vec2 q = w - e * clamp(dot(w, e) / dot(e, e), 0.0, 1.0);\n"
+    "        d = min(d, dot(q, q));\n"
+    "        bvec3 c = bvec3(p.y >= a.y, p.y < b.y, e.x * w.y > e.y * w.x);\n"
+    "        if (all(c) || all(not(c)))\n"
+    "            s = -s;\n"
+    "        b = a;\n"
+    "    }\n"
+    "    return s * sqrt(d);\n"
+    "}\n"
+    "\n"
+    "float cover(float d, float unit) {\n"
+    "    return clamp(0.5 - d * unit, 0.0, 1.0);\n"
+    "}\n"
+    "\n"
+    "void main() {\n"
+    "    vec3 color = vec3(0.0);\n"
+    "    if (u_charging)\n"
+    "        color = mix(color, vec3(1.0), cover(polygon(v_bolt), u_units.y));\n"
+    "    if (u_visible) {\n"
+    "        vec2 p = v_battery;\n"
+    "        float outline = max(box(p, u_body), -box(p, u_inner));\n"
+    "        color = mix(color, vec3(1.0), cover(min(outline, box(p, u_terminal)), u_units.x));\n"
+    "        vec4 gauge = u_gauge;\n"
+    "        gauge.w *= u_level;\n"
+    "        gauge.y += u_gauge.w - gauge.w;\n"
+    "        if (u_level > 0.0)\n"
+    "            color = mix(color, u_gauge_color, cover(box(p, gauge), u_units.x));\n"
+    "        if (u_show_oled)\n"
+    "            color = mix(color, vec3(0.5), cover(box(v_oled, u_oled), u_units.z));\n"
+    "    }\n"
+    "    gl_FragColor = vec4(color, 1.0);\n"
+    "}\n";
+
+static const char* const main_attributes[] = { "a_pos", NULL };
+
+/* text comes straight from a font_batch, positions in pixels */
+static const char text_vertex_source[] =
+    "uniform vec2 u_screen;\n"
+    "attribute vec2 a_pos;\n"
+    "attribute vec4 a_color;\n"
+    "attribute vec2 a_uv;\n"
+    "varying vec4 v_color;\n"
+    "varying vec2 v_uv;\n"
+    "void main() {\n"
+    "    vec2 p = a_pos / u_screen * 2.0 - 1.0;\n"
+    "    gl_Position = vec4(p.x, -p.y, 0.0, 1.0);\n"
+    "    v_color = a_color;\n"
+    "    v_uv = a_uv;\n"
+    "}\n";
+
+static const char text_fragment_source[] =
+    "precision mediump float;\n"
+    "uniform sampler2D u_atlas;\n"
+    "varying vec4 v_color;\n"
+    "varying vec2 v_uv;\n"
+    "void main() {\n"
+    "    gl_FragColor = texture2D(u_atlas, v_uv) * v_color;\n"
+    "}\n";
+
+static const char* const text_attributes[] = { "a_pos", "a_color", "a_uv", NULL };
+
+struct gles_backend {
+    SDL_Window* window;
+    SDL_GLContext context;
+    GLuint program;
+    GLuint text_program;
+    GLuint buffer;
+    GLuint font;
+    GLint level;
+    GLint gauge_color;
+    GLint oled;
+    GLint charging;
+    GLint visible;
+    struct render_layout layout;
+    struct font_batch text[2]; /* the percentage and the time to full */
+    GLushort text_indices[FONT_MAX_TEXT * 6]; /* ES2 has no 32 bit indices */
+    bool window_mode;
+};
+
+static void gles_destroy(struct render_backend* backend);
+
+static GLuint compile_shader(GLenum type, const char* source)
+{
+    GLuint shader = glCreateShader(type);
+    GLint ok = GL_FALSE;
+
+    glShaderSource(shader, 1, &source, NULL);
+    glCompileShader(shader);
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &ok);
+    if (!ok) {
+        char log[512] = "";
+        glGetShaderInfoLog(shader, sizeof(log), NULL, log);
+        ERROR("failed to compile shader: %s", log);
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+/* attributes are bound in order, from location 0 */
+static GLuint link_program(const char* vertex_source, const char* fragment_source, const char* const* attributes)
+{
+    GLuint vertex = compile_shader(GL_VERTEX_SHADER, vertex_source);
+    GLuint fragment = compile_shader(GL_FRAGMENT_SHADER, fragment_source);
+    GLuint program = 0;
+    GLint ok = GL_FALSE;
+
+    if (vertex && fragment) {
+        program = glCreateProgram();
+        glAttachShader(program, vertex);
+        glAttachShader(program, fragment);
+        for (GLuint i = 0; attributes[i]; ++i)
+            glBindAttribLocation(program, i, attributes[i]);
+        glLinkProgram(program);
+        glGetProgramiv(program, GL_LINK_STATUS, &ok);
+        if (!ok) {
+            char log[512] = "";
+            glGetProgramInfoLog(program, sizeof(log), NULL, log);
+            ERROR("failed to link shaders: %s", log);
+            glDeleteProgram(program);
+            program = 0;
+        }
+    }
+    /* the program keeps them for as long as it needs them */
+    if (vertex)
+        glDeleteShader(vertex);
+    if (fragment)
+        glDeleteShader(fragment);
+    return program;
+}
+
+/* the atlas never changes, upload it once */
+static GLuint upload_font(void)
+{
+    SDL_Surface* atlas = font_atlas(SDL_PIXELFORMAT_RGBA32);
+    GLuint texture = 0;
+
+    if (!atlas) {
+        ERROR("failed to create font atlas: %s", SDL_GetError());
+        return 0;
+    }
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    /* GLES2 has no row length, the rows have to be packed */
+    if (atlas->pitch == atlas->w * 4) {
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, atlas->w, atlas->h, 0, GL_RGBA, GL_UNSIGNED_BYTE, atlas->pixels);
+    } else {
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, atlas->w, atlas->h, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        for (int y = 0; y < atlas->h; ++y)
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, y, atlas->w, 1, GL_RGBA, GL_UNSIGNED_BYTE,
+                (const Uint8*)atlas->pixels + y * atlas->pitch);
+    }
+    /* whole pixel scales only, keep the glyphs sharp */
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    SDL_FreeSurface(atlas);
+    return texture;
+}
+
+/* a frame centered on rect, in units of its half height */
+static void frame_uniform(GLint location, SDL_Rect rect)
+{
+    glUniform3f(location, rect.x + rect.w / 2.0f, rect.y + rect.h / 2.0f, rect.h / 2.0f);
+}
+
+/* rect as center and half size in the frame of the one around it */
+static void rect_uniform(GLuint program, const char* name, SDL_Rect rect, SDL_Rect frame)
+{
+    const float unit = frame.h / 2.0f;
+
+    glUniform4f(glGetUniformLocation(program, name),
+        (rect.x + rect.w / 2.0f - frame.x - frame.w / 2.0f) / unit,
+        (rect.y + rect.h / 2.0f - frame.y - frame.h / 2.0f) / unit,
+        rect.w / 2.0f / unit, rect.h / 2.0f / unit);
+}
+
+/* the same shapes the CPU icons have, see make_battery_icon */
+static void set_layout_uniforms(struct gles_backend* gles, int w, int h)
+{
+    const SDL_Rect body = gles->layout.battery;
+    const SDL_Rect charging = gles->layout.charging;
+    const SDL_Rect oled = gles->layout.oled;
+    SDL_Rect inner = body;
+    SDL_Rect terminal;
+    SDL_Rect gauge;
+    SDL_Point bolt[LIGHTNING_POINTS];
+    GLfloat points[LIGHTNING_POINTS * 2];
+
+    inner.x += body.h * 0.05;
+    inner.y += body.h * 0.05;
+    inner.w -= body.h * 0.1;
+    inner.h -= body.h * 0.1;
+
+    terminal = inner;
+    terminal.y -= inner.h / 10;
+    terminal.x += inner.w * 0.2;
+    terminal.h = inner.h * 0.1;
+    terminal.w -= inner.w * 0.4;
+
+    /* full, the shader shortens it to the charge level */
+    make_gauge_rect(body, 100, &gauge);
+
+    make_lightning_outline(charging.w, charging.h, bolt);
+    for (int i = 0; i < LIGHTNING_POINTS; ++i) {
+        points[i * 2] = (bolt[i].x - charging.w / 2.0f) / (charging.h / 2.0f);
+        points[i * 2 + 1] = (bolt[i].y - charging.h / 2.0f) / (charging.h / 2.0f);
+    }
+
+    glUniform2f(glGetUniformLocation(gles->program, "u_screen"), w, h);
+    frame_uniform(glGetUniformLocation(gles->program, "u_battery_frame"), body);
+    frame_uniform(glGetUniformLocation(gles->program, "u_bolt_frame"), charging);
+    glUniform3f(glGetUniformLocation(gles->program, "u_units"), body.h / 2.0f, charging.h / 2.0f,
+        oled.h / 2.0f);
+    rect_uniform(gles->program, "u_body", body, body);
+    rect_uniform(gles->program, "u_inner", inner, body);
+    rect_uniform(gles->program, "u_terminal", terminal, body);
+    rect_uniform(gles->program, "u_gauge", gauge, body);
+    /* the square moves with its frame, in which it never does */
+    rect_uniform(gles->program, "u_oled", oled, oled);
+    glUniform2fv(glGetUniformLocation(gles->program, "u_bolt"), LIGHTNING_POINTS, points);
+}
+
+static bool gles_init(struct render_backend* backend, const struct render_options* options)
+{
+    struct gles_backend* gles = calloc(1, sizeof(*gles));
+    int w;
+    int h;
+
+    if (!gles)
+        return false;
+    backend->priv = gles;
+    gles->window_mode = options->window;
+
+    gles->window = render_create_window(options, SDL_WINDOW_OPENGL, &w, &h);
+    if (!gles->window) {
+        gles_destroy(backend);
+        return false;
+    }
+
+    gles->context = SDL_GL_CreateContext(gles->window);
+    if (!gles->context) {
+        ERROR("failed to create GLES2 context: %s", SDL_GetError());
+        gles_destroy(backend);
+        return false;
+    }
+    SDL_GL_GetDrawableSize(gles->window, &w, &h);
+    backend->width = w;
+    backend->height = h;
+
+    LOG("INFO", "%s", (const char*)glGetString(GL_RENDERER));
+
+    gles->program = link_program(vertex_source, fragment_source, main_attributes);
+    gles->text_program = link_program(text_vertex_source, text_fragment_source, text_attributes);
+    gles->font = upload_font();
+    if (!gles->program || !gles->text_program || !gles->font) {
+        gles_destroy(backend);
+        return false;
+    }
+
+    glUseProgram(gles->text_program);
+    glUniform2f(glGetUniformLocation(gles->text_program, "u_screen"), w, h);
+    glUniform1i(glGetUniformLocation(gles->text_program, "u_atlas"), 0);
+    glUseProgram(gles->program);
+
+    /* the batches always use the same quads, only the count changes */
+    for (int i = 0; i < FONT_MAX_TEXT * 6; ++i) {
+        static const GLushort quad[] = { 0, 1, 2, 0, 2, 3 };
+        gles->text_indices[i] = i / 6 * 4 + quad[i % 6];
+    }
+
+    glGenBuffers(1, &gles->buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, gles->buffer);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(screen_triangle), screen_triangle, GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, NULL);
+    glEnableVertexAttribArray(0);
+
+    render_layout(w, h, &gles->layout);
+    set_layout_uniforms(gles, w, h);
+    glUniform1i(glGetUniformLocation(gles->program, "u_show_oled"), options->oled);
+
+    gles->level = glGetUniformLocation(gles->program, "u_level");
+    gles->gauge_color = glGetUniformLocation(gles->program, "u_gauge_color");
+    gles->oled = glGetUniformLocation(gles->program, "u_oled_frame");
+    gles->charging = glGetUniformLocation(gles->program, "u_charging");
+    gles->visible = glGetUniformLocation(gles->program, "u_visible");
+
+    glViewport(0, 0, w, h);
+    glDisable(GL_DEPTH_TEST);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    return true;
+}
+
+static void gles_draw(struct render_backend* backend, const struct frame_state* frame)
+{
+    struct gles_backend* gles = backend->priv;
+    const SDL_Color color = gauge_color(frame->percent);
+    SDL_Rect oled = gles->layout.oled;
+
+    /* the text pass below leaves its own state behind */
+    glUseProgram(gles->program);
+    glBindBuffer(GL_ARRAY_BUFFER, gles->buffer);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, NULL);
+    glDisableVertexAttribArray(1);
+    glDisableVertexAttribArray(2);
+    glDisable(GL_BLEND);
+
+    glUniform1f(gles->level, frame->percent / 100.0f);
+    glUniform3f(gles->gauge_color, color.r / 255.0f, color.g / 255.0f, color.b / 255.0f);
+    oled.x = frame->oled.x;
+    oled.y = frame->oled.y;
+    frame_uniform(gles->oled, oled);
+    glUniform1i(gles->charging, frame->charging);
+    glUniform1i(gles->visible, frame->battery_visible);
+
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+
+    if (frame->battery_visible) {
+        frame_text_line lines[2];
+        const SDL_Color white = { 255, 255, 255, 255 };
+        const SDL_Rect* text = &gles->layout.text;
+
+        frame_text(frame, lines[0], lines[1]);
+        glUseProgram(gles->text_program);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindTexture(GL_TEXTURE_2D, gles->font);
+        glEnableVertexAttribArray(1);
+        glEnableVertexAttribArray(2);
+        glEnable(GL_BLEND);
+        for (int l = 0; l < 2; ++l) {
+            struct font_batch* batch = &gles->text[l];
+            font_batch_set(batch, lines[l], text->x + text->w / 2, text->y + l * gles->layout.text_line,
+                gles->layout.text_scale, white);
+            if (batch->glyphs == 0)
+                continue;
+            glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(font_vertex), &batch->vertices[0].position);
+            glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(font_vertex), &batch->vertices[0].color);
+            glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(font_vertex), &batch->vertices[0].tex_coord);
+            glDrawElements(GL_TRIANGLES, batch->glyphs * 6, GL_UNSIGNED_SHORT, gles->text_indices);
+        }
+    }
+
+    if (gles->window_mode) {
+        LOG("INFO", "refresh");
+    }
+    SDL_GL_SwapWindow(gles->window);
+}
+
+static void gles_destroy(struct render_backend* backend)
+{
+    struct gles_backend* gles = backend->priv;
+
+    if (!gles)
+        return;
+
+    if (gles->buffer)
+        glDeleteBuffers(1, &gles->buffer);
+    if (gles->font)
+        glDeleteTextures(1, &gles->font);
+    if (gles->text_program)
+        glDeleteProgram(gles->text_program);
+    if (gles->program)
+        glDeleteProgram(gles->program);
+    if (gles->context)
+        SDL_GL_DeleteContext(gles->context);
+    if (gles->window)
+        SDL_DestroyWindow(gles->window);
+    SDL_Quit();
+
+    free(gles);
+    backend->priv = NULL;
+}
+
+const struct render_backend render_backend_gles = {
+    .name = "gles",
+    .handles_input = true,
+    .init = gles_init,
+    .draw = gles_draw,
+    .destroy = gles_destroy,
+};
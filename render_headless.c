@@ -0,0 +1,86 @@
+#include <SDL2/SDL.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "render.h"
+#include "log.h"
+
+/* screen size unless CHARGE_MODE_HEADLESS_SIZE says otherwise */
+#define HEADLESS_WIDTH 540
+#define HEADLESS_HEIGHT 960
+
+struct headless_backend {
+    SDL_Surface* surface;
+    struct soft_painter painter;
+    const char* frame_dir; /* NULL to not save frames */
+    unsigned int frame;
+};
+
+static bool headless_init(struct render_backend* backend, const struct render_options* options)
+{
+    struct headless_backend* headless = calloc(1, sizeof(*headless));
+    const char* size = getenv("CHARGE_MODE_HEADLESS_SIZE");
+    int w = HEADLESS_WIDTH;
+    int h = HEADLESS_HEIGHT;
+
+    if (!headless)
+        return false;
+
+    if (size && (sscanf(size, "%ix%i", &w, &h) != 2 || w <= 0 || h <= 0)) {
+        ERROR("invalid CHARGE_MODE_HEADLESS_SIZE %s, expected WIDTHxHEIGHT", size);
+        free(headless);
+        return false;
+    }
+    backend->width = w;
+    backend->height = h;
+
+    headless->frame_dir = getenv("CHARGE_MODE_FRAME_DIR");
+    headless->surface = SDL_CreateRGBSurfaceWithFormat(0, w, h, 32, SDL_PIXELFORMAT_RGB888);
+    if (!headless->surface || !soft_painter_init(&headless->painter, w, h, options)) {
+        ERROR("failed to create %ix%i offscreen surface: %s", w, h, SDL_GetError());
+        SDL_FreeSurface(headless->surface);
+        free(headless);
+        return false;
+    }
+
+    LOG("INFO", "rendering %ix%i offscreen%s%s", w, h, headless->frame_dir ? " to " : "",
+        headless->frame_dir ? headless->frame_dir : "");
+    backend->priv = headless;
+    return true;
+}
+
+static void headless_draw(struct render_backend* backend, const struct frame_state* frame)
+{
+    struct headless_backend* headless = backend->priv;
+    char path[PATH_MAX];
+
+    soft_painter_draw(&headless->painter, headless->surface, frame);
+
+    if (headless->frame_dir) {
+        snprintf(path, sizeof(path), "%s/frame-%05u.ppm", headless->frame_dir, headless->frame);
+        render_write_ppm(headless->surface, path);
+    }
+    ++headless->frame;
+}
+
+static void headless_destroy(struct render_backend* backend)
+{
+    struct headless_backend* headless = backend->priv;
+
+    if (!headless)
+        return;
+
+    soft_painter_destroy(&headless->painter);
+    SDL_FreeSurface(headless->surface);
+    free(headless);
+    backend->priv = NULL;
+}
+
+const struct render_backend render_backend_headless = {
+    .name = "headless",
+    .handles_input = false,
+    .init = headless_init,
+    .draw = headless_draw,
+    .destroy = headless_destroy,
+};
@@ -0,0 +1,309 @@
+#include <SDL2/SDL.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <xf86drm.h>
+#include <xf86drmMode.h>
+
+#include "render.h"
+#include "log.h"
+
+#define DRM_DEVICE "/dev/dri/card0"
+
+/* ms to wait for a page flip before assuming it got lost */
+#define FLIP_TIMEOUT 100
+
+struct kms_buffer {
+    uint32_t handle;
+    uint32_t fb_id;
+    uint32_t pitch;
+    uint64_t size;
+    void* map;
+    SDL_Surface* surface;
+};
+
+struct kms_backend {
+    int fd;
+    uint32_t connector_id;
+    uint32_t crtc_id;
+    drmModeModeInfo mode;
+    drmModeCrtc* saved_crtc; /* what was on screen before us, put back on exit */
+    struct kms_buffer buffers[2];
+    int front;
+    bool mode_set;
+    bool flip_pending;
+    struct soft_painter painter;
+};
+
+static void kms_destroy(struct render_backend* backend);
+
+static uint32_t find_crtc(int fd, drmModeRes* res, drmModeConnector* conn)
+{
+    drmModeEncoder* enc;
+    uint32_t crtc_id = 0;
+
+    /* keep the current routing if there is one */
+    if (conn->encoder_id) {
+        enc = drmModeGetEncoder(fd, conn->encoder_id);
+        if (enc) {
+            crtc_id = enc->crtc_id;
+            drmModeFreeEncoder(enc);
+            if (crtc_id)
+                return crtc_id;
+        }
+    }
+
+    for (int i = 0; i < conn->count_encoders && !crtc_id; ++i) {
+        enc = drmModeGetEncoder(fd, conn->encoders[i]);
+        if (!enc)
+            continue;
+        for (int j = 0; j < res->count_crtcs; ++j) {
+            if (enc->possible_crtcs & (1u << j)) {
+                crtc_id = res->crtcs[j];
+                break;
+            }
+        }
+        drmModeFreeEncoder(enc);
+    }
+
+    return crtc_id;
+}
+
+static bool find_output(struct kms_backend* kms)
+{
+    drmModeRes* res = drmModeGetResources(kms->fd);
+    bool found = false;
+
+    if (!res) {
+        ERROR("failed to get drm resources: %s", strerror(errno));
+        return false;
+    }
+
+    for (int i = 0; i < res->count_connectors && !found; ++i) {
+        drmModeConnector* conn = drmModeGetConnector(kms->fd, res->connectors[i]);
+        if (!conn)
+            continue;
+
+        if (conn->connection == DRM_MODE_CONNECTED && conn->count_modes > 0) {
+            uint32_t crtc_id = find_crtc(kms->fd, res, conn);
+            if (crtc_id) {
+                kms->connector_id = conn->connector_id;
+                kms->crtc_id = crtc_id;
+                kms->mode = conn->modes[0];
+                for (int j = 0; j < conn->count_modes; ++j) {
+                    if (conn->modes[j].type & DRM_MODE_TYPE_PREFERRED) {
+                        kms->mode = conn->modes[j];
+                        break;
+                    }
+                }
+                found = true;
+            }
+        }
+        drmModeFreeConnector(conn);
+    }
+
+    drmModeFreeResources(res);
+    return found;
+}
+
+static bool create_buffer(struct kms_backend* kms, struct kms_buffer* buf)
+{
+    struct drm_mode_create_dumb create = {
+        .width = kms->mode.hdisplay,
+        .height = kms->mode.vdisplay,
+        .bpp = 32,
+    };
+    struct drm_mode_map_dumb map = { 0 };
+
+    if (drmIoctl(kms->fd, DRM_IOCTL_MODE_CREATE_DUMB, &create) < 0) {
+        ERROR("failed to create dumb buffer: %s", strerror(errno));
+        return false;
+    }
+    buf->handle = create.handle;
+    buf->pitch = create.pitch;
+    buf->size = create.size;
+
+    if (drmModeAddFB(kms->fd, create.width, create.height, 24, 32, buf->pitch, buf->handle, &buf->fb_id) < 0) {
+        ERROR("failed to add framebuffer: %s", strerror(errno));
+        return false;
+    }
+
+    map.handle = buf->handle;
+    if (drmIoctl(kms->fd, DRM_IOCTL_MODE_MAP_DUMB, &map) < 0) {
+        ERROR("failed to map dumb buffer: %s", strerror(errno));
+        return false;
+    }
+    buf->map = mmap(NULL, buf->size, PROT_READ | PROT_WRITE, MAP_SHARED, kms->fd, map.offset);
+    if (buf->map == MAP_FAILED) {
+        buf->map = NULL;
+        ERROR("failed to mmap dumb buffer: %s", strerror(errno));
+        return false;
+    }
+
+    /* depth 24, bpp 32 is XRGB8888 */
+    buf->surface = SDL_CreateRGBSurfaceWithFormatFrom(buf->map, create.width, create.height, 32, buf->pitch,
+        SDL_PIXELFORMAT_RGB888);
+    if (!buf->surface) {
+        ERROR("failed to wrap dumb buffer: %s", SDL_GetError());
+        return false;
+    }
+    return true;
+}
+
+static void destroy_buffer(struct kms_backend* kms, struct kms_buffer* buf)
+{
+    struct drm_mode_destroy_dumb destroy = { .handle = buf->handle };
+
+    SDL_FreeSurface(buf->surface);
+    if (buf->map)
+        munmap(buf->map, buf->size);
+    if (buf->fb_id)
+        drmModeRmFB(kms->fd, buf->fb_id);
+    if (buf->handle)
+        drmIoctl(kms->fd, DRM_IOCTL_MODE_DESTROY_DUMB, &destroy);
+    memset(buf, 0, sizeof(*buf));
+}
+
+static void on_page_flip(int fd, unsigned int sequence, unsigned int sec, unsigned int usec, void* data)
+{
+    struct kms_backend* kms = data;
+    kms->flip_pending = false;
+}
+
+/* the back buffer may still be scanned out until the last flip completed */
+static void wait_for_flip(struct kms_backend* kms)
+{
+    drmEventContext ctx = {
+        .version = 2,
+        .page_flip_handler = on_page_flip,
+    };
+    struct pollfd pfd = { .fd = kms->fd, .events = POLLIN };
+
+    while (kms->flip_pending) {
+        int ret = poll(&pfd, 1, FLIP_TIMEOUT);
+        if (ret < 0 && errno == EINTR)
+            continue;
+        if (ret <= 0) {
+            LOG("WARN", "page flip timed out");
+            kms->flip_pending = false;
+            break;
+        }
+        drmHandleEvent(kms->fd, &ctx);
+    }
+}
+
+static bool kms_init(struct render_backend* backend, const struct render_options* options)
+{
+    struct kms_backend* kms = calloc(1, sizeof(*kms));
+    const char* device = getenv("CHARGE_MODE_DRM_DEVICE");
+    uint64_t has_dumb = 0;
+
+    if (!kms)
+        return false;
+    backend->priv = kms;
+
+    if (!device)
+        device = DRM_DEVICE;
+
+    LOG("INFO", "opening %s", device);
+    kms->fd = open(device, O_RDWR | O_CLOEXEC);
+    if (kms->fd < 0) {
+        ERROR("failed to open %s: %s", device, strerror(errno));
+        free(kms);
+        backend->priv = NULL;
+        return false;
+    }
+
+    if (drmGetCap(kms->fd, DRM_CAP_DUMB_BUFFER, &has_dumb) < 0 || !has_dumb) {
+        ERROR("%s does not support dumb buffers", device);
+        kms_destroy(backend);
+        return false;
+    }
+
+    if (!find_output(kms)) {
+        ERROR("no connected output on %s", device);
+        kms_destroy(backend);
+        return false;
+    }
+    backend->width = kms->mode.hdisplay;
+    backend->height = kms->mode.vdisplay;
+    LOG("INFO", "using mode %s on connector %u, crtc %u", kms->mode.name, kms->connector_id, kms->crtc_id);
+
+    kms->saved_crtc = drmModeGetCrtc(kms->fd, kms->crtc_id);
+
+    for (int i = 0; i < 2; ++i) {
+        if (!create_buffer(kms, &kms->buffers[i])) {
+            kms_destroy(backend);
+            return false;
+        }
+    }
+
+    if (!soft_painter_init(&kms->painter, backend->width, backend->height, options)) {
+        kms_destroy(backend);
+        return false;
+    }
+
+    return true;
+}
+
+static void kms_draw(struct render_backend* backend, const struct frame_state* frame)
+{
+    struct kms_backend* kms = backend->priv;
+    struct kms_buffer* back = &kms->buffers[kms->front ^ 1];
+
+    wait_for_flip(kms);
+    soft_painter_draw(&kms->painter, back->surface, frame);
+
+    if (!kms->mode_set) {
+        if (drmModeSetCrtc(kms->fd, kms->crtc_id, back->fb_id, 0, 0, &kms->connector_id, 1, &kms->mode) < 0) {
+            ERROR("failed to set mode: %s", strerror(errno));
+            return;
+        }
+        kms->mode_set = true;
+    } else if (drmModePageFlip(kms->fd, kms->crtc_id, back->fb_id, DRM_MODE_PAGE_FLIP_EVENT, kms) < 0) {
+        ERROR("failed to flip: %s", strerror(errno));
+        return;
+    } else {
+        kms->flip_pending = true;
+    }
+    kms->front ^= 1;
+}
+
+static void kms_destroy(struct render_backend* backend)
+{
+    struct kms_backend* kms = backend->priv;
+
+    if (!kms)
+        return;
+
+    wait_for_flip(kms);
+
+    if (kms->saved_crtc) {
+        drmModeCrtc* crtc = kms->saved_crtc;
+        if (kms->mode_set)
+            drmModeSetCrtc(kms->fd, crtc->crtc_id, crtc->buffer_id, crtc->x, crtc->y, &kms->connector_id, 1,
+                &crtc->mode);
+        drmModeFreeCrtc(crtc);
+    }
+
+    soft_painter_destroy(&kms->painter);
+    for (int i = 0; i < 2; ++i)
+        destroy_buffer(kms, &kms->buffers[i]);
+    close(kms->fd);
+
+    free(kms);
+    backend->priv = NULL;
+}
+
+const struct render_backend render_backend_kms = {
+    .name = "kms",
+    .handles_input = false,
+    .init = kms_init,
+    .draw = kms_draw,
+    .destroy = kms_destroy,
+};
@@ -0,0 +1,192 @@
+#include <SDL2/SDL.h>
+#include <GLES2/gl2.h>
+#include <stdlib.h>
+
+#include "render.h"
+#include "draw.h"
+#include "gauge.h"
+#include "log.h"
+
+struct sdl_backend {
+    SDL_Window* window;
+    SDL_Renderer* renderer;
+    SDL_Texture* battery_icon;
+    SDL_Texture* lightning_icon;
+    SDL_Texture* font;
+    struct font_batch text[2]; /* the percentage and the time to full */
+    struct gauge_atlas gauge;
+    bool gauge_valid;
+    struct render_layout layout;
+    bool oled;
+    bool window_mode;
+};
+
+static void sdl_destroy(struct render_backend* backend);
+
+static SDL_Texture* icon_texture(SDL_Renderer* renderer, SDL_Surface* icon)
+{
+    SDL_Texture* texture;
+
+    if (!icon)
+        return NULL;
+    texture = SDL_CreateTextureFromSurface(renderer, icon);
+    /* the texture is all we need from here on */
+    SDL_FreeSurface(icon);
+    return texture;
+}
+
+/* watched rather than polled, the main loop takes the events off the queue */
+static int on_sdl_event(void* data, SDL_Event* event)
+{
+    struct sdl_backend* sdl = data;
+
+    /* the gauges baked into the atlas do not survive a lost render target */
+    if (event->type == SDL_RENDER_TARGETS_RESET || event->type == SDL_RENDER_DEVICE_RESET) {
+        LOG("INFO", "render targets reset, baking the gauges again");
+        gauge_atlas_invalidate(&sdl->gauge);
+    }
+    return 0;
+}
+
+static bool sdl_init(struct render_backend* backend, const struct render_options* options)
+{
+    struct sdl_backend* sdl = calloc(1, sizeof(*sdl));
+    int w;
+    int h;
+
+    if (!sdl)
+        return false;
+    backend->priv = sdl;
+    sdl->oled = options->oled;
+    sdl->window_mode = options->window;
+
+    sdl->window = render_create_window(options, 0, &w, &h);
+    if (!sdl->window) {
+        sdl_destroy(backend);
+        return false;
+    }
+    backend->width = w;
+    backend->height = h;
+
+    LOG("INFO", "creating general renderer");
+    sdl->renderer = SDL_CreateRenderer(sdl->window, -1, 0);
+    if (!sdl->renderer) {
+        ERROR("failed to create renderer: %s", SDL_GetError());
+        sdl_destroy(backend);
+        return false;
+    }
+
+    LOG("INFO", "%s", (const char*)glGetString(GL_RENDERER));
+
+    render_layout(w, h, &sdl->layout);
+
+    LOG("INFO", "creating textures from icons");
+    sdl->battery_icon = icon_texture(sdl->renderer,
+        make_battery_icon(sdl->layout.battery, options->icon_format));
+    sdl->lightning_icon = icon_texture(sdl->renderer,
+        make_lightning_icon(sdl->layout.charging.w, sdl->layout.charging.h, options->icon_format));
+    sdl->font = icon_texture(sdl->renderer, font_atlas(options->icon_format));
+    if (!sdl->battery_icon || !sdl->lightning_icon || !sdl->font) {
+        ERROR("failed to create icons: %s", SDL_GetError());
+        sdl_destroy(backend);
+        return false;
+    }
+
+#if SDL_VERSION_ATLEAST(2, 0, 12)
+    /* the font is scaled by whole pixels, keep them square */
+    SDL_SetTextureScaleMode(sdl->font, SDL_ScaleModeNearest);
+#endif
+
+    gauge_atlas_init(&sdl->gauge, sdl->renderer, sdl->battery_icon, sdl->layout.battery);
+    sdl->gauge_valid = true;
+    SDL_AddEventWatch(on_sdl_event, sdl);
+
+    SDL_RenderClear(sdl->renderer);
+    return true;
+}
+
+static void sdl_draw(struct render_backend* backend, const struct frame_state* frame)
+{
+    struct sdl_backend* sdl = backend->priv;
+
+    SDL_SetRenderDrawColor(sdl->renderer, 0, 0, 0, 255);
+    SDL_RenderClear(sdl->renderer);
+
+    if (frame->charging)
+        SDL_RenderCopy(sdl->renderer, sdl->lightning_icon, NULL, &sdl->layout.charging);
+
+    if (frame->battery_visible) {
+        gauge_draw(&sdl->gauge, sdl->renderer, frame->percent);
+
+        if (sdl->oled) {
+            SDL_Rect oled = sdl->layout.oled;
+            oled.x = frame->oled.x;
+            oled.y = frame->oled.y;
+            SDL_SetRenderDrawColor(sdl->renderer, 128, 128, 128, 255);
+            SDL_RenderFillRect(sdl->renderer, &oled);
+        }
+
+        frame_text_line lines[2];
+        const SDL_Rect* text = &sdl->layout.text;
+        frame_text(frame, lines[0], lines[1]);
+        for (int l = 0; l < 2; ++l) {
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+            struct font_batch* batch = &sdl->text[l];
+            font_batch_set(batch, lines[l], text->x + text->w / 2, text->y + l * sdl->layout.text_line,
+                sdl->layout.text_scale, (SDL_Color) { 255, 255, 255, 255 });
+            if (batch->glyphs > 0)
+                SDL_RenderGeometry(sdl->renderer, sdl->font, batch->vertices, batch->glyphs * 4,
+                    batch->indices, batch->glyphs * 6);
+#else
+            /* no geometry before SDL 2.0.18, a copy per glyph */
+            struct font_quad quads[FONT_MAX_TEXT];
+            const int scale = sdl->layout.text_scale;
+            int count = font_layout(lines[l], text->x + (text->w - font_text_width(lines[l], scale)) / 2,
+                text->y + l * sdl->layout.text_line, scale, quads);
+
+            for (int i = 0; i < count; ++i)
+                SDL_RenderCopy(sdl->renderer, sdl->font, &quads[i].src, &quads[i].dst);
+#endif
+        }
+    }
+
+    if (sdl->window_mode) {
+        LOG("INFO", "refresh");
+    }
+    SDL_RenderPresent(sdl->renderer);
+}
+
+static void sdl_destroy(struct render_backend* backend)
+{
+    struct sdl_backend* sdl = backend->priv;
+
+    if (!sdl)
+        return;
+
+    if (sdl->gauge_valid) {
+        SDL_DelEventWatch(on_sdl_event, sdl);
+        gauge_atlas_destroy(&sdl->gauge);
+    }
+    if (sdl->battery_icon)
+        SDL_DestroyTexture(sdl->battery_icon);
+    if (sdl->lightning_icon)
+        SDL_DestroyTexture(sdl->lightning_icon);
+    if (sdl->font)
+        SDL_DestroyTexture(sdl->font);
+    if (sdl->renderer)
+        SDL_DestroyRenderer(sdl->renderer);
+    if (sdl->window)
+        SDL_DestroyWindow(sdl->window);
+    SDL_Quit();
+
+    free(sdl);
+    backend->priv = NULL;
+}
+
+const struct render_backend render_backend_sdl = {
+    .name = "sdl",
+    .handles_input = true,
+    .init = sdl_init,
+    .draw = sdl_draw,
+    .destroy = sdl_destroy,
+};
@@ -0,0 +1,123 @@
+#include "rtc_alarm.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/rtc.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include "log.h"
+
+/* the RTC keeps UTC, like the kernel assumes for wake alarms */
+static int read_wakealarm(int rtc_fd, time_t* when)
+{
+    struct rtc_wkalrm wake;
+    struct tm tm = { 0 };
+
+    if (ioctl(rtc_fd, RTC_WKALM_RD, &wake) < 0)
+        return -1;
+
+    if (wake.enabled != 1 || wake.time.tm_year == -1)
+        return 1;
+
+    tm.tm_sec = wake.time.tm_sec;
+    tm.tm_min = wake.time.tm_min;
+    tm.tm_hour = wake.time.tm_hour;
+    tm.tm_mday = wake.time.tm_mday;
+    tm.tm_mon = wake.time.tm_mon;
+    tm.tm_year = wake.time.tm_year;
+
+    *when = timegm(&tm);
+    if (*when == (time_t)-1)
+        return -1;
+
+    return 0;
+}
+
+/* the alarm clock needs CAP_WAKE_ALARM, without it we only miss waking from suspend */
+static int alarm_timer_new(void)
+{
+    int fd = timerfd_create(CLOCK_REALTIME_ALARM, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (fd < 0 && (errno == EPERM || errno == EINVAL)) {
+        LOG("WARN", "no alarm clock, rtc alarms will not wake from suspend");
+        fd = timerfd_create(CLOCK_REALTIME, TFD_NONBLOCK | TFD_CLOEXEC);
+    }
+    if (fd < 0) {
+        ERROR("can not create alarm timer: %s", strerror(errno));
+    }
+    return fd;
+}
+
+static void arm(struct rtc_alarm* alarm)
+{
+    /* a passed alarm would fire right away, and disarmed timers are not
+       cancelled by clock changes, so keep the timer armed far out instead */
+    struct itimerspec spec = {
+        .it_value.tv_sec = alarm->when > time(NULL) ? alarm->when : INT32_MAX,
+    };
+
+    if (timerfd_settime(alarm->timer_fd, TFD_TIMER_ABSTIME | TFD_TIMER_CANCEL_ON_SET, &spec, NULL) < 0) {
+        ERROR("can not arm alarm timer: %s", strerror(errno));
+    }
+}
+
+int rtc_alarm_open(struct rtc_alarm* alarm, const char* device)
+{
+    alarm->when = 0;
+    alarm->timer_fd = -1;
+    alarm->rtc_fd = open(device, O_RDONLY | O_CLOEXEC);
+    if (alarm->rtc_fd < 0) {
+        LOG("INFO", "failed to open RTC: %s", device);
+        return -1;
+    }
+
+    alarm->timer_fd = alarm_timer_new();
+    if (alarm->timer_fd < 0) {
+        close(alarm->rtc_fd);
+        alarm->rtc_fd = -1;
+        return -1;
+    }
+
+    if (rtc_alarm_update(alarm) < 0) {
+        LOG("INFO", "failed to read RTC: %s", device);
+    }
+    return 0;
+}
+
+int rtc_alarm_update(struct rtc_alarm* alarm)
+{
+    time_t when;
+    int ret = read_wakealarm(alarm->rtc_fd, &when);
+
+    alarm->when = ret == 0 ? when : 0;
+    arm(alarm);
+    return ret;
+}
+
+bool rtc_alarm_ack(struct rtc_alarm* alarm)
+{
+    uint64_t expirations;
+
+    /* only a pending alarm is armed to fire, time() may still lag behind it */
+    if (read(alarm->timer_fd, &expirations, sizeof(expirations)) == sizeof(expirations))
+        return alarm->when != 0;
+
+    if (errno == ECANCELED) {
+        LOG("INFO", "clock was set, rearming rtc alarm");
+        rtc_alarm_update(alarm);
+    }
+    return false;
+}
+
+void rtc_alarm_close(struct rtc_alarm* alarm)
+{
+    if (alarm->timer_fd >= 0)
+        close(alarm->timer_fd);
+    if (alarm->rtc_fd >= 0)
+        close(alarm->rtc_fd);
+    alarm->timer_fd = -1;
+    alarm->rtc_fd = -1;
+}
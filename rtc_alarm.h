@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stdbool.h>
+#include <time.h>
+
+/**
+  The wake alarm of an RTC, followed by a timerfd on CLOCK_REALTIME_ALARM so
+  it fires on time from the event loop, also out of suspend. Setting the clock
+  cancels the timer, it is then armed again from a fresh look at the RTC.
+*/
+struct rtc_alarm {
+    int rtc_fd;
+    int timer_fd; /* readable when the alarm is due or the clock was set */
+    time_t when; /* unix time of the alarm, 0 if none is set */
+};
+
+/**
+  open the RTC, read its wake alarm and arm the timer for it
+  @param device the RTC device, e.g. /dev/rtc0
+  @returns 0 on success, -1 on failure, the fds are -1 then
+*/
+int rtc_alarm_open(struct rtc_alarm* alarm, const char* device);
+
+/**
+  read the wake alarm from the RTC again and arm the timer for it
+  @returns 0 if an alarm is set, 1 if none is, -1 on error
+*/
+int rtc_alarm_update(struct rtc_alarm* alarm);
+
+/**
+  consume a wakeup of timer_fd
+  @returns true if the alarm is due, false if the clock was set and the timer
+           was armed again
+*/
+bool rtc_alarm_ack(struct rtc_alarm* alarm);
+
+/**
+  close the timer and the RTC
+*/
+void rtc_alarm_close(struct rtc_alarm* alarm);
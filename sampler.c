@@ -0,0 +1,282 @@
+#include "sampler.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "battery.h"
+#include "log.h"
+#include "uevent.h"
+
+/* the battery_info fields a battery_device is made of */
+#define DEVICE_FIELDS (BATTERY_FRACTION | BATTERY_CURRENT | BATTERY_SOURCE)
+
+/* the time to full needs the status, voltage and energy of every battery,
+   only worth reading while something charges us */
+static unsigned int device_fields(const struct battery_device* dev)
+{
+    return dev->is_charging ? DEVICE_FIELDS | BATTERY_SECONDS_TO_FULL : DEVICE_FIELDS;
+}
+
+static void device_from_info(struct battery_device* dev, const struct battery_info* bat)
+{
+    dev->current = bat->current;
+    if (!isfinite(bat->fraction) || bat->fraction <= 0) {
+        dev->percent = 1;
+        LOG("WARN", "Battery Percent out of range");
+    } else {
+        dev->percent = (int)(bat->fraction * 100.0);
+    }
+    LOG("INFO", "Battery Percent: %d", dev->percent);
+    /* any online input charges us */
+    dev->is_charging = bat->source != BATTERY && bat->source != UNKOWN;
+    dev->seconds_to_full = isfinite(bat->seconds_to_full) ? (int)bat->seconds_to_full : -1;
+}
+
+void battery_device_update(struct battery_device* dev, bool mock)
+{
+    if(!mock)
+    {
+        struct battery_info bat;
+        unsigned int fields = device_fields(dev);
+        LOG("INFO", "Reading Battery");
+        if (battery_fill_info_mask(&bat, fields)) {
+            device_from_info(dev, &bat);
+            /* a charger just came, get its time to full now rather than next sample */
+            if (fields != device_fields(dev) && battery_fill_info_mask(&bat, device_fields(dev)))
+                device_from_info(dev, &bat);
+        } else {
+            LOG("WARN", "Could not read battery");
+        }
+    }
+    else
+    {
+        static int state = 0;
+        const int percents[] = {50, 90, 10, 0, 1, -1, 100};
+        LOG("INFO", "mock percentage: %i", percents[state]);
+        dev->is_charging = true;
+        dev->current = -10;
+        dev->percent = percents[state++];
+        dev->seconds_to_full = dev->percent >= 0 && dev->percent < 100 ? (100 - dev->percent) * 90 : -1;
+        if(state > (sizeof(percents)/sizeof(percents[0]))-1)
+            state = 0;
+
+    }
+}
+
+static void eventfd_signal(int fd)
+{
+    uint64_t one = 1;
+    write(fd, &one, sizeof(one));
+}
+
+static bool eventfd_ack(int fd)
+{
+    uint64_t count;
+    return read(fd, &count, sizeof(count)) == sizeof(count);
+}
+
+/* only ever called from one thread at a time, the seqlock has a single writer */
+static void publish(struct sampler* sampler, const struct battery_device* dev)
+{
+    unsigned int seq = atomic_load_explicit(&sampler->seq, memory_order_relaxed);
+
+    atomic_store_explicit(&sampler->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    memcpy(&sampler->sample, dev, sizeof(*dev));
+    atomic_store_explicit(&sampler->seq, seq + 2, memory_order_release);
+
+    eventfd_signal(sampler->notify_fd);
+}
+
+static void sample(struct sampler* sampler)
+{
+    struct battery_device dev;
+
+    /* keep the last values for whatever can not be read */
+    sampler_latest(sampler, &dev);
+    battery_device_update(&dev, sampler->mock);
+    publish(sampler, &dev);
+}
+
+/* after uevents updated the nodes they were about */
+static void sample_from_uevents(struct sampler* sampler)
+{
+    struct battery_device dev;
+    struct battery_info bat;
+
+    sampler_latest(sampler, &dev);
+    /* the events carried every property, the time to full costs no reads here */
+    if (!battery_aggregate(&bat, DEVICE_FIELDS | BATTERY_SECONDS_TO_FULL)) {
+        sample(sampler);
+        return;
+    }
+    device_from_info(&dev, &bat);
+    publish(sampler, &dev);
+}
+
+static void on_request(int fd, uint32_t events, void* data)
+{
+    struct sampler* sampler = data;
+
+    if (eventfd_ack(fd) && !atomic_load(&sampler->stop))
+        sample(sampler);
+}
+
+static void on_poll_timer(int fd, uint32_t events, void* data)
+{
+    timer_ack(fd);
+    sample(data);
+}
+
+static void on_uevent(int fd, uint32_t events, void* data)
+{
+    struct sampler* sampler = data;
+    char buf[4096];
+    struct uevent ev;
+    bool changed = false;
+    bool reread = false;
+    int ret;
+
+    while ((ret = uevent_receive(fd, buf, sizeof(buf), &ev)) >= 0) {
+        if (ret == 0)
+            continue;
+        LOG("INFO", "uevent: %s %s", ev.action, ev.name ? ev.name : ev.devpath);
+        changed = true;
+        if (uevent_changes_nodes(&ev)) {
+            battery_invalidate();
+            reread = true;
+        } else if (!ev.name || !battery_update_uevent(ev.name, ev.payload, ev.payload_len)) {
+            reread = true;
+        }
+    }
+
+    /* the events carry the new values, only read sysfs for nodes we don't know */
+    if (reread)
+        sample(sampler);
+    else if (changed)
+        sample_from_uevents(sampler);
+}
+
+static void* sampler_thread(void* data)
+{
+    struct sampler* sampler = data;
+
+    while (!atomic_load(&sampler->stop)) {
+        if (event_loop_dispatch(&sampler->loop, -1) < 0)
+            break;
+        atomic_fetch_add_explicit(&sampler->wakeups, 1, memory_order_relaxed);
+    }
+    return NULL;
+}
+
+static void sampler_close(struct sampler* sampler)
+{
+    if (sampler->uevent_fd >= 0)
+        close(sampler->uevent_fd);
+    if (sampler->poll_timer >= 0)
+        close(sampler->poll_timer);
+    if (sampler->request_fd >= 0)
+        close(sampler->request_fd);
+    if (sampler->notify_fd >= 0)
+        close(sampler->notify_fd);
+    event_loop_destroy(&sampler->loop);
+}
+
+int sampler_start(struct sampler* sampler, bool mock, unsigned int poll_interval,
+    const struct battery_device* first)
+{
+    memset(sampler, 0, sizeof(*sampler));
+    sampler->mock = mock;
+    sampler->uevent_fd = -1;
+    atomic_init(&sampler->stop, false);
+    atomic_init(&sampler->seq, 0);
+    atomic_init(&sampler->wakeups, 0);
+
+    if (event_loop_init(&sampler->loop) < 0)
+        return -1;
+
+    sampler->notify_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    sampler->request_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    sampler->poll_timer = timer_new();
+    if (sampler->notify_fd < 0 || sampler->request_fd < 0 || sampler->poll_timer < 0) {
+        ERROR("failed to create sampler fds");
+        sampler_close(sampler);
+        return -1;
+    }
+    event_loop_add(&sampler->loop, sampler->request_fd, on_request, sampler);
+    event_loop_add(&sampler->loop, sampler->poll_timer, on_poll_timer, sampler);
+
+    if (!mock) {
+        sampler->uevent_fd = uevent_open();
+        if (sampler->uevent_fd < 0) {
+            LOG("WARN", "no uevents, only polling the battery");
+        } else {
+            event_loop_add(&sampler->loop, sampler->uevent_fd, on_uevent, sampler);
+        }
+    }
+    timer_arm(sampler->poll_timer, poll_interval, true);
+
+    /* the first frame needs a real value, have it before anyone reads */
+    if (first)
+        publish(sampler, first);
+    else
+        sample(sampler);
+
+    if (pthread_create(&sampler->thread, NULL, sampler_thread, sampler) != 0) {
+        ERROR("failed to start sampler thread");
+        sampler_close(sampler);
+        return -1;
+    }
+    return 0;
+}
+
+void sampler_request(struct sampler* sampler)
+{
+    eventfd_signal(sampler->request_fd);
+}
+
+void sampler_set_interval(struct sampler* sampler, unsigned int poll_interval)
+{
+    /* timerfd_settime is fine from any thread, the sampler just sees the new period */
+    timer_arm(sampler->poll_timer, poll_interval, true);
+}
+
+bool sampler_has_uevents(const struct sampler* sampler)
+{
+    return sampler->uevent_fd >= 0;
+}
+
+unsigned int sampler_wakeups(struct sampler* sampler)
+{
+    return atomic_load_explicit(&sampler->wakeups, memory_order_relaxed);
+}
+
+bool sampler_ack(struct sampler* sampler)
+{
+    return eventfd_ack(sampler->notify_fd);
+}
+
+void sampler_latest(struct sampler* sampler, struct battery_device* dev)
+{
+    unsigned int begin, end;
+
+    do {
+        begin = atomic_load_explicit(&sampler->seq, memory_order_acquire);
+        memcpy(dev, &sampler->sample, sizeof(*dev));
+        atomic_thread_fence(memory_order_acquire);
+        end = atomic_load_explicit(&sampler->seq, memory_order_relaxed);
+    } while (begin != end || (begin & 1));
+}
+
+void sampler_stop(struct sampler* sampler)
+{
+    atomic_store(&sampler->stop, true);
+    eventfd_signal(sampler->request_fd);
+    pthread_join(sampler->thread, NULL);
+
+    sampler_close(sampler);
+    battery_close();
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+
+#include "eventloop.h"
+
+struct battery_device {
+    double current;
+    int is_charging;
+    int percent;
+    int seconds_to_full; /* -1 if unknown or not charging */
+};
+
+/**
+  read the battery once, in the calling thread
+  @param dev updated with what was read, left alone if nothing could be read
+  @param mock step through made up values instead of reading sysfs
+*/
+void battery_device_update(struct battery_device* dev, bool mock);
+
+/**
+  Reads the battery on its own thread, so slow fuel gauges can not stall the
+  render loop. The thread owns the battery code and the uevent socket, and
+  hands samples to the main thread through a seqlock.
+*/
+struct sampler {
+    pthread_t thread;
+    struct event_loop loop;
+    int notify_fd; /* readable when a new sample was published */
+    int request_fd; /* wakes the thread for a sample or to stop */
+    int uevent_fd;
+    int poll_timer;
+    bool mock;
+    atomic_bool stop;
+    atomic_uint seq; /* odd while the sample is being written */
+    atomic_uint wakeups; /* times the thread woke up, to check what polling costs */
+    struct battery_device sample;
+};
+
+/**
+  start the thread
+  @param sampler the sampler to start
+  @param mock use a mock battery
+  @param poll_interval ms between samples until sampler_set_interval changes it
+  @param first a sample just taken to publish first, NULL to take one now
+  @returns 0 on success, -1 on failure
+*/
+int sampler_start(struct sampler* sampler, bool mock, unsigned int poll_interval,
+    const struct battery_device* first);
+
+/**
+  ask for a fresh sample, a notification follows when it is published
+*/
+void sampler_request(struct sampler* sampler);
+
+/**
+  change the time between samples, the next one is poll_interval from now
+*/
+void sampler_set_interval(struct sampler* sampler, unsigned int poll_interval);
+
+/**
+  @returns true if changes are announced by uevents, false if only polling sees them
+*/
+bool sampler_has_uevents(const struct sampler* sampler);
+
+/**
+  @returns how often the thread woke up since it was started
+*/
+unsigned int sampler_wakeups(struct sampler* sampler);
+
+/**
+  consume the notifications on notify_fd
+  @returns true if a sample was published since the last call
+*/
+bool sampler_ack(struct sampler* sampler);
+
+/**
+  copy the latest sample, never waits for the sampler thread
+*/
+void sampler_latest(struct sampler* sampler, struct battery_device* dev);
+
+/**
+  stop and join the thread and release the battery code
+*/
+void sampler_stop(struct sampler* sampler);
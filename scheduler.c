@@ -0,0 +1,97 @@
+#include "scheduler.h"
+
+#include <ctype.h>
+#include <errno.h>
+#include <stdlib.h>
+
+/* charge levels something happens at */
+static const struct {
+    int percent;
+    bool charging; /* only crossed, or only matters, while charging */
+} thresholds[] = {
+    { 20, true }, /* autoboot */
+    { 5, false }, /* booting on key press */
+};
+
+/* percent around a threshold where we want to notice crossing it quickly */
+#define THRESHOLD_MARGIN 2
+
+/* divisor of the longest interval while the display shows the level */
+#define DISPLAY_DIVISOR 4
+
+/* multiple of the shortest interval near thresholds or without uevents */
+#define ATTENTIVE_FACTOR 4
+
+/* longest interval accepted, an hour without a sample is already plenty */
+#define BOUND_MAX_MS (60 * 60 * 1000)
+
+static unsigned int min_ms(unsigned int a, unsigned int b)
+{
+    return a < b ? a : b;
+}
+
+/* strtoul takes a sign and wraps negative numbers around, only allow digits */
+static bool parse_ms(const char* str, char** end, unsigned long* ms)
+{
+    if (!isdigit((unsigned char)*str))
+        return false;
+    errno = 0;
+    *ms = strtoul(str, end, 10);
+    return errno == 0 && *ms <= BOUND_MAX_MS;
+}
+
+bool schedule_parse_bounds(const char* str, struct schedule_bounds* bounds)
+{
+    unsigned long min, max;
+    char* end;
+
+    if (!parse_ms(str, &end, &min) || *end != ':')
+        return false;
+    if (!parse_ms(end + 1, &end, &max) || *end != '\0')
+        return false;
+    if (min == 0 || min > max)
+        return false;
+    bounds->min = min;
+    bounds->max = max;
+    return true;
+}
+
+unsigned int schedule_poll_interval(const struct schedule_bounds* bounds, const struct schedule_state* state)
+{
+    const unsigned int attentive = min_ms(bounds->min * ATTENTIVE_FACTOR, bounds->max);
+    unsigned int interval = bounds->max;
+
+    /* plugging in is often followed by wiggling the cable */
+    if (state->recent_plug)
+        return bounds->min;
+
+    /* without uevents an unplug is only noticed by polling */
+    if (!state->uevents)
+        interval = min_ms(interval, attentive);
+
+    if (state->display_on)
+        interval = min_ms(interval, bounds->max / DISPLAY_DIVISOR);
+
+    for (size_t i = 0; i < sizeof(thresholds) / sizeof(thresholds[0]); ++i) {
+        if (thresholds[i].charging && !state->charging)
+            continue;
+        if (abs(state->percent - thresholds[i].percent) <= THRESHOLD_MARGIN)
+            interval = min_ms(interval, attentive);
+    }
+
+    return interval < bounds->min ? bounds->min : interval;
+}
+
+void wakeup_rate_reset(struct wakeup_rate* rate, unsigned int count)
+{
+    clock_gettime(CLOCK_MONOTONIC, &rate->since);
+    rate->base = count;
+}
+
+double wakeup_rate(const struct wakeup_rate* rate, unsigned int count)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    double seconds = (now.tv_sec - rate->since.tv_sec) + (now.tv_nsec - rate->since.tv_nsec) / 1e9;
+    return seconds > 0 ? (count - rate->base) / seconds : 0;
+}
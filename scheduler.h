@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stdbool.h>
+#include <time.h>
+
+/* what the battery poll interval depends on */
+struct schedule_state {
+    bool display_on;
+    bool charging;
+    int percent;
+    bool recent_plug; /* the charger came or went a moment ago */
+    bool uevents; /* the kernel tells us about changes, polls only catch drift */
+};
+
+/* ms, the interval never leaves these */
+struct schedule_bounds {
+    unsigned int min;
+    unsigned int max;
+};
+
+/**
+  parse bounds given as "MIN:MAX" in ms, with 0 < MIN <= MAX <= one hour
+  @returns true on success, bounds is left alone otherwise
+*/
+bool schedule_parse_bounds(const char* str, struct schedule_bounds* bounds);
+
+/**
+  pick the battery poll interval for a state
+  @returns the interval in ms, within bounds
+*/
+unsigned int schedule_poll_interval(const struct schedule_bounds* bounds, const struct schedule_state* state);
+
+/* wakeups counted from a point in time */
+struct wakeup_rate {
+    struct timespec since;
+    unsigned int base;
+};
+
+/**
+  start counting from now
+  @param count the wakeup count now
+*/
+void wakeup_rate_reset(struct wakeup_rate* rate, unsigned int count);
+
+/**
+  @param count the wakeup count now
+  @returns wakeups per second since the last reset
+*/
+double wakeup_rate(const struct wakeup_rate* rate, unsigned int count);
@@ -0,0 +1,72 @@
+#include "suspend.h"
+
+#include <string.h>
+
+#include "log.h"
+
+static const struct suspend_backend* const backends[] = {
+    &suspend_backend_mem,
+    &suspend_backend_sleep,
+};
+
+const struct suspend_backend* suspend_backend_find(const char* name)
+{
+    for (size_t i = 0; i < sizeof(backends) / sizeof(backends[0]); ++i) {
+        if (strcmp(backends[i]->name, name) == 0)
+            return backends[i];
+    }
+    return NULL;
+}
+
+bool suspend_init(struct suspend* suspend, const struct suspend_backend* template,
+    const char* sysfs_root, const char* rtc)
+{
+    suspend->backend = *template;
+    suspend->count = 0;
+    if (!suspend->backend.init(&suspend->backend, sysfs_root, rtc))
+        return false;
+
+    suspend->user_alarm = suspend->backend.get_wakealarm(&suspend->backend);
+    if (suspend->user_alarm) {
+        LOG("INFO", "keeping the rtc alarm at %lld", (long long)suspend->user_alarm);
+    }
+    return true;
+}
+
+/* the RTC has one alarm, leave it as the user set it whenever we are awake */
+static void restore_user_alarm(struct suspend* suspend)
+{
+    struct suspend_backend* backend = &suspend->backend;
+
+    /* a passed alarm can not be set again, and has done its job */
+    backend->set_wakealarm(backend, suspend->user_alarm > time(NULL) ? suspend->user_alarm : 0);
+}
+
+int suspend_for(struct suspend* suspend, unsigned int seconds)
+{
+    struct suspend_backend* backend = &suspend->backend;
+    time_t when = time(NULL) + seconds;
+
+    if (suspend->user_alarm > time(NULL) && suspend->user_alarm < when)
+        when = suspend->user_alarm;
+
+    if (backend->set_wakealarm(backend, when) < 0) {
+        ERROR("could not set the rtc wake alarm, not suspending");
+        restore_user_alarm(suspend);
+        return -1;
+    }
+
+    int ret = backend->suspend(backend);
+    restore_user_alarm(suspend);
+    if (ret < 0)
+        return -1;
+
+    ++suspend->count;
+    return 0;
+}
+
+void suspend_destroy(struct suspend* suspend)
+{
+    restore_user_alarm(suspend);
+    suspend->backend.destroy(&suspend->backend);
+}
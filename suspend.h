@@ -0,0 +1,61 @@
+#pragma once
+
+#include <stdbool.h>
+#include <time.h>
+
+/**
+  How the system is put to sleep and woken by the RTC. The tables below are
+  templates, copy one and call init on the copy.
+*/
+struct suspend_backend {
+    const char* name;
+    bool (*init)(struct suspend_backend* backend, const char* sysfs_root, const char* rtc);
+    /* the RTC wake alarm as a unix time, 0 if there is none */
+    time_t (*get_wakealarm)(struct suspend_backend* backend);
+    /* 0 clears the alarm, returns 0 on success, -1 on failure */
+    int (*set_wakealarm)(struct suspend_backend* backend, time_t when);
+    /* returns after resume, -1 if suspend was refused or a wakeup came in first */
+    int (*suspend)(struct suspend_backend* backend);
+    void (*destroy)(struct suspend_backend* backend);
+    void* priv;
+};
+
+/* suspend to RAM through /sys/power/state, guarded by /sys/power/wakeup_count */
+extern const struct suspend_backend suspend_backend_mem;
+/* sleeps until the wake alarm instead of suspending, to try the state machine */
+extern const struct suspend_backend suspend_backend_sleep;
+
+/**
+  look up a backend template by name
+  @returns returns the backend or NULL if there is none of that name
+*/
+const struct suspend_backend* suspend_backend_find(const char* name);
+
+/* a backend and the alarm the user had set before we used the RTC */
+struct suspend {
+    struct suspend_backend backend;
+    time_t user_alarm;
+    unsigned int count; /* successful suspends */
+};
+
+/**
+  set up a backend and remember the wake alarm it had
+  @param template the backend to copy
+  @param sysfs_root where sysfs is mounted
+  @param rtc the RTC device, its name selects the RTC in sysfs
+  @returns true on success
+*/
+bool suspend_init(struct suspend* suspend, const struct suspend_backend* template,
+    const char* sysfs_root, const char* rtc);
+
+/**
+  suspend until at most seconds from now, or the user's alarm if that is
+  earlier, and put the user's alarm back after resume
+  @returns 0 after a resume, -1 if the system did not suspend
+*/
+int suspend_for(struct suspend* suspend, unsigned int seconds);
+
+/**
+  put the user's alarm back and release the backend
+*/
+void suspend_destroy(struct suspend* suspend);
@@ -0,0 +1,140 @@
+#include "suspend.h"
+
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "log.h"
+
+#define POWER_STATE "/power/state"
+#define POWER_WAKEUP_COUNT "/power/wakeup_count"
+#define RTC_CLASS_PATH "/class/rtc/"
+#define RTC_WAKEALARM "/wakealarm"
+
+struct mem_priv {
+    char state[PATH_MAX];
+    char wakeup_count[PATH_MAX];
+    char wakealarm[PATH_MAX];
+};
+
+static int read_file(const char* path, char* buf, size_t size)
+{
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return -1;
+    ssize_t len = read(fd, buf, size - 1);
+    close(fd);
+    if (len < 0)
+        return -1;
+    buf[len] = '\0';
+    return 0;
+}
+
+/* sysfs attributes take one value per open */
+static int write_file(const char* path, const char* value)
+{
+    int fd = open(path, O_WRONLY | O_CLOEXEC);
+    if (fd < 0)
+        return -1;
+    ssize_t len = strlen(value);
+    ssize_t ret = write(fd, value, len);
+    close(fd);
+    return ret == len ? 0 : -1;
+}
+
+static bool mem_init(struct suspend_backend* backend, const char* sysfs_root, const char* rtc)
+{
+    struct mem_priv* priv = calloc(1, sizeof(*priv));
+    const char* rtc_name = strrchr(rtc, '/');
+    char states[64];
+
+    if (!priv)
+        return false;
+
+    rtc_name = rtc_name ? rtc_name + 1 : rtc;
+    snprintf(priv->state, PATH_MAX, "%s%s", sysfs_root, POWER_STATE);
+    snprintf(priv->wakeup_count, PATH_MAX, "%s%s", sysfs_root, POWER_WAKEUP_COUNT);
+    snprintf(priv->wakealarm, PATH_MAX, "%s%s%s%s", sysfs_root, RTC_CLASS_PATH, rtc_name, RTC_WAKEALARM);
+
+    if (read_file(priv->state, states, sizeof(states)) < 0 || !strstr(states, "mem")) {
+        ERROR("suspend to RAM is not supported");
+        free(priv);
+        return false;
+    }
+    if (access(priv->wakealarm, W_OK) != 0) {
+        ERROR("%s can not wake us up", rtc_name);
+        free(priv);
+        return false;
+    }
+
+    backend->priv = priv;
+    return true;
+}
+
+static time_t mem_get_wakealarm(struct suspend_backend* backend)
+{
+    struct mem_priv* priv = backend->priv;
+    char buf[32];
+
+    /* empty without an alarm */
+    if (read_file(priv->wakealarm, buf, sizeof(buf)) < 0)
+        return 0;
+    return (time_t)strtoll(buf, NULL, 10);
+}
+
+static int mem_set_wakealarm(struct suspend_backend* backend, time_t when)
+{
+    struct mem_priv* priv = backend->priv;
+    char buf[32];
+
+    /* an active alarm is never overwritten, it has to be cleared first */
+    if (write_file(priv->wakealarm, "0") < 0)
+        return -1;
+    if (!when)
+        return 0;
+    snprintf(buf, sizeof(buf), "%lld", (long long)when);
+    return write_file(priv->wakealarm, buf);
+}
+
+static int mem_suspend(struct suspend_backend* backend)
+{
+    struct mem_priv* priv = backend->priv;
+    char count[32];
+
+    /* writing back the count fails if a wakeup event came in since reading it,
+       so a key press just before suspending is not lost */
+    if (read_file(priv->wakeup_count, count, sizeof(count)) == 0) {
+        count[strcspn(count, "\n")] = '\0';
+        if (write_file(priv->wakeup_count, count) < 0) {
+            LOG("INFO", "wakeup event pending, not suspending");
+            return -1;
+        }
+    }
+
+    LOG("INFO", "suspending");
+    /* blocks until resume */
+    if (write_file(priv->state, "mem") < 0) {
+        LOG("WARN", "suspend failed");
+        return -1;
+    }
+    LOG("INFO", "resumed");
+    return 0;
+}
+
+static void mem_destroy(struct suspend_backend* backend)
+{
+    free(backend->priv);
+    backend->priv = NULL;
+}
+
+const struct suspend_backend suspend_backend_mem = {
+    .name = "mem",
+    .init = mem_init,
+    .get_wakealarm = mem_get_wakealarm,
+    .set_wakealarm = mem_set_wakealarm,
+    .suspend = mem_suspend,
+    .destroy = mem_destroy,
+};
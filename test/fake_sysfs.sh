@@ -0,0 +1,129 @@
+#!/bin/sh
+
+# Build and drive a fake sysfs tree for charging_sdl, so the real parsing,
+# supply selection and backlight code can run on any machine:
+#
+#   fake_sysfs.sh create ROOT [BATTERIES] [USB]
+#       new tree with BATTERIES (default 1) batteries, USB (default 1)
+#       usb supplies and one backlight
+#   fake_sysfs.sh set ROOT SUPPLY ATTRIBUTE VALUE
+#       change one attribute, the supply's uevent file is kept in sync
+#   fake_sysfs.sh remove ROOT SUPPLY
+#       drop a supply, as if its driver was unbound
+#   fake_sysfs.sh play ROOT SCRIPT
+#       run a scenario, one command per line:
+#           set SUPPLY ATTRIBUTE VALUE
+#           add-battery SUPPLY
+#           add-usb SUPPLY
+#           remove SUPPLY
+#           sleep SECONDS
+#       empty lines and lines starting with # are ignored
+#
+# Point charging_sdl at it with: charging_sdl -s ROOT (or CHARGE_MODE_SYSFS=ROOT)
+
+set -e
+
+usage() {
+    sed -n '3,22p' "$0" | sed 's/^# \{0,1\}//'
+    exit 1
+}
+
+supplies() {
+    echo "$1/class/power_supply"
+}
+
+write_uevent() {
+    dir="$1"
+    name=$(basename "$dir")
+    {
+        echo "POWER_SUPPLY_NAME=$name"
+        for f in "$dir"/*; do
+            attr=$(basename "$f")
+            [ "$attr" = uevent ] && continue
+            [ -f "$f" ] || continue
+            key=$(echo "$attr" | tr 'a-z' 'A-Z')
+            echo "POWER_SUPPLY_$key=$(cat "$f")"
+        done
+    } > "$dir/uevent"
+}
+
+set_attr() {
+    dir="$(supplies "$1")/$2"
+    [ -d "$dir" ] || { echo "no such supply: $2" >&2; exit 1; }
+    echo "$4" > "$dir/$3"
+    write_uevent "$dir"
+}
+
+add_battery() {
+    dir="$(supplies "$1")/$2"
+    mkdir -p "$dir"
+    echo Battery > "$dir/type"
+    echo 1 > "$dir/present"
+    echo Charging > "$dir/status"
+    echo 50 > "$dir/capacity"
+    echo 3900000 > "$dir/voltage_now"
+    echo -500000 > "$dir/current_now"
+    echo 250 > "$dir/temp"
+    echo 0 > "$dir/time_to_empty_now"
+    write_uevent "$dir"
+}
+
+add_usb() {
+    dir="$(supplies "$1")/$2"
+    mkdir -p "$dir"
+    echo USB > "$dir/type"
+    echo 1 > "$dir/online"
+    write_uevent "$dir"
+}
+
+add_backlight() {
+    dir="$1/class/backlight/$2"
+    mkdir -p "$dir"
+    echo 255 > "$dir/max_brightness"
+    echo 255 > "$dir/brightness"
+    echo raw > "$dir/type"
+}
+
+create() {
+    root="$1"
+    batteries="${2:-1}"
+    usb="${3:-1}"
+
+    mkdir -p "$(supplies "$root")" "$root/class/backlight"
+    i=0
+    while [ $i -lt "$batteries" ]; do
+        add_battery "$root" "battery$i"
+        i=$((i + 1))
+    done
+    i=0
+    while [ $i -lt "$usb" ]; do
+        add_usb "$root" "usb$i"
+        i=$((i + 1))
+    done
+    add_backlight "$root" backlight0
+}
+
+play() {
+    root="$1"
+    while read -r cmd a b c; do
+        case "$cmd" in
+            ''|'#'*) ;;
+            set) set_attr "$root" "$a" "$b" "$c" ;;
+            add-battery) add_battery "$root" "$a" ;;
+            add-usb) add_usb "$root" "$a" ;;
+            remove) rm -rf "$(supplies "$root")/$a" ;;
+            sleep) sleep "$a" ;;
+            *) echo "unknown command: $cmd" >&2; exit 1 ;;
+        esac
+    done < "$2"
+}
+
+[ $# -ge 2 ] || usage
+
+case "$1" in
+    create) shift; create "$@" ;;
+    set) [ $# -eq 5 ] || usage; set_attr "$2" "$3" "$4" "$5" ;;
+    remove) [ $# -eq 3 ] || usage; rm -rf "$(supplies "$2")/$3" ;;
+    play) [ $# -eq 3 ] || usage; play "$2" "$3" ;;
+    *) usage ;;
+esac
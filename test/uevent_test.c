@@ -0,0 +1,239 @@
+/*
+ * Feeds canned power_supply uevents through a socketpair into
+ * uevent_receive() and battery_update_uevent(), the way the sampler does,
+ * against a synthetic power_supply tree.
+ *
+ * Prints one line per failed check and exits with status 1 if there was one.
+ *
+ * usage: uevent_test
+ */
+
+#define _XOPEN_SOURCE 700
+
+#include <ftw.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "battery.h"
+#include "uevent.h"
+
+#define DEVPATH "/devices/platform/test/power_supply/"
+
+static int failures;
+
+#define CHECK(cond)                                                       \
+    do {                                                                  \
+        if (!(cond)) {                                                    \
+            printf("FAIL %s:%i: %s\n", __FILE__, __LINE__, #cond);       \
+            ++failures;                                                   \
+        }                                                                 \
+    } while (0)
+
+static const char* const battery_attrs[] = {
+    "present", "1", "status", "Charging", "capacity", "50",
+    "voltage_now", "3900000", "current_now", "-500000", "temp", "250", NULL
+};
+/* what the driver announces later, while sysfs still says the above */
+static const char* const battery_changed[] = {
+    "present", "1", "status", "Discharging", "capacity", "42",
+    "voltage_now", "3800000", "current_now", "300000", "temp", "260", NULL
+};
+static const char* const online[] = { "online", "1", NULL };
+/* a gamepad reporting its own battery, more of them than the cache had room for once */
+static const char* const gamepad[] = { "scope", "device", "capacity", "80", NULL };
+#define GAMEPADS 64
+static const char* const offline[] = { "online", "0", NULL };
+
+static void write_attr(const char* dir, const char* attr, const char* value)
+{
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", dir, attr);
+    FILE* f = fopen(path, "w");
+    if (!f) {
+        perror(path);
+        exit(1);
+    }
+    fprintf(f, "%s\n", value);
+    fclose(f);
+}
+
+/* the KEY=VALUE lines of a supply, separated by sep */
+static int properties(char* buf, size_t size, const char* name, const char* type,
+    const char* const* attrs, char sep)
+{
+    int len = snprintf(buf, size, "POWER_SUPPLY_NAME=%s%cPOWER_SUPPLY_TYPE=%s%c", name, sep, type, sep);
+
+    for (; attrs && attrs[0]; attrs += 2) {
+        char key[64];
+        int i;
+
+        for (i = 0; attrs[0][i] && i < (int)sizeof(key) - 1; ++i)
+            key[i] = attrs[0][i] >= 'a' && attrs[0][i] <= 'z' ? attrs[0][i] - 'a' + 'A' : attrs[0][i];
+        key[i] = '\0';
+        len += snprintf(buf + len, size - len, "POWER_SUPPLY_%s=%s%c", key, attrs[1], sep);
+    }
+    return len;
+}
+
+static void add_supply(const char* root, const char* name, const char* type, const char* const* attrs)
+{
+    char dir[512];
+    char uevent[2048];
+
+    snprintf(dir, sizeof(dir), "%s/class/power_supply/%s", root, name);
+    mkdir(dir, 0755);
+
+    write_attr(dir, "type", type);
+    for (const char* const* attr = attrs; attr && attr[0]; attr += 2)
+        write_attr(dir, attr[0], attr[1]);
+    properties(uevent, sizeof(uevent), name, type, attrs, '\n');
+    write_attr(dir, "uevent", uevent);
+}
+
+static int remove_entry(const char* path, const struct stat* sb, int flag, struct FTW* ftw)
+{
+    return remove(path);
+}
+
+static void remove_supply(const char* root, const char* name)
+{
+    char dir[512];
+
+    snprintf(dir, sizeof(dir), "%s/class/power_supply/%s", root, name);
+    nftw(dir, remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+}
+
+/* a message laid out like the kernel's: "ACTION@DEVPATH", then NUL separated KEY=VALUE pairs */
+static void send_uevent(int fd, const char* action, const char* subsystem, const char* name,
+    const char* type, const char* const* attrs)
+{
+    char msg[4096];
+    int len = snprintf(msg, sizeof(msg), "%s@" DEVPATH "%s%cACTION=%s%cDEVPATH=" DEVPATH "%s%cSUBSYSTEM=%s%c",
+        action, name, '\0', action, '\0', name, '\0', subsystem, '\0');
+
+    if (type)
+        len += properties(msg + len, sizeof(msg) - len, name, type, attrs, '\0');
+    if (send(fd, msg, len, 0) != len) {
+        perror("send");
+        exit(1);
+    }
+}
+
+/* what the sampler does with an event, true if the cached values were enough */
+static bool apply(const struct uevent* ev)
+{
+    if (uevent_changes_nodes(ev)) {
+        battery_invalidate();
+        return false;
+    }
+    return ev->name && battery_update_uevent(ev->name, ev->payload, ev->payload_len);
+}
+
+static void run(const char* root)
+{
+    struct battery_info info;
+    struct uevent ev;
+    char buf[4096];
+    int sv[2];
+
+    if (socketpair(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK, 0, sv) < 0) {
+        perror("socketpair");
+        exit(1);
+    }
+
+    battery_set_sysfs_root(root);
+    CHECK(battery_fill_info(&info));
+    CHECK(info.state == CHARGING);
+    CHECK(info.source == USB);
+    CHECK(fabs(info.fraction - 0.5) < 0.01);
+
+    /* supplies that don't power the system are known, but not looked at */
+    CHECK(battery_update_uevent("gamepad0", "", 0));
+    CHECK(!battery_update_uevent("gamepad99", "", 0));
+
+    /* nothing sent yet */
+    CHECK(uevent_receive(sv[1], buf, sizeof(buf), &ev) == -1);
+
+    /* a change carries every property, the cached node takes them without reading sysfs */
+    send_uevent(sv[0], "change", "power_supply", "battery0", "Battery", battery_changed);
+    CHECK(uevent_receive(sv[1], buf, sizeof(buf), &ev) == 1);
+    CHECK(strcmp(ev.action, "change") == 0);
+    CHECK(ev.name && strcmp(ev.name, "battery0") == 0);
+    CHECK(strcmp(ev.devpath, DEVPATH "battery0") == 0);
+    CHECK(!uevent_changes_nodes(&ev));
+    CHECK(apply(&ev));
+    CHECK(battery_aggregate(&info, BATTERY_ALL));
+    CHECK(info.state == ON_BATTERY);
+    CHECK(fabs(info.fraction - 0.42) < 0.01);
+    CHECK(fabs(info.voltage - 3.8) < 0.001);
+
+    /* other subsystems are not ours */
+    send_uevent(sv[0], "change", "input", "event3", NULL, NULL);
+    CHECK(uevent_receive(sv[1], buf, sizeof(buf), &ev) == 0);
+
+    /* a removed charger drops the node cache, the next fill rescans */
+    remove_supply(root, "usb0");
+    send_uevent(sv[0], "remove", "power_supply", "usb0", "USB", offline);
+    CHECK(uevent_receive(sv[1], buf, sizeof(buf), &ev) == 1);
+    CHECK(uevent_changes_nodes(&ev));
+    CHECK(!apply(&ev));
+    CHECK(!battery_aggregate(&info, BATTERY_ALL));
+    CHECK(battery_fill_info(&info));
+    CHECK(!battery_update_uevent("usb0", "", 0));
+    /* with no charger left to ask, where the power comes from is unknown */
+    CHECK(info.source == UNKOWN);
+
+    /* an unknown node asks for a full read until the cache knows it */
+    add_supply(root, "ac0", "Mains", online);
+    CHECK(!battery_update_uevent("ac0", "", 0));
+    send_uevent(sv[0], "add", "power_supply", "ac0", "Mains", online);
+    CHECK(uevent_receive(sv[1], buf, sizeof(buf), &ev) == 1);
+    CHECK(uevent_changes_nodes(&ev));
+    CHECK(!apply(&ev));
+    CHECK(battery_fill_info(&info));
+    CHECK(info.source == MAINS);
+
+    /* and then follows it from its events */
+    send_uevent(sv[0], "change", "power_supply", "ac0", "Mains", offline);
+    CHECK(uevent_receive(sv[1], buf, sizeof(buf), &ev) == 1);
+    CHECK(apply(&ev));
+    CHECK(battery_aggregate(&info, BATTERY_ALL));
+    CHECK(info.source == BATTERY);
+
+    battery_close();
+    close(sv[0]);
+    close(sv[1]);
+}
+
+int main(void)
+{
+    char root[] = "/tmp/uevent_test.XXXXXX";
+    char path[512];
+
+    if (!mkdtemp(root)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    snprintf(path, sizeof(path), "%s/class", root);
+    mkdir(path, 0755);
+    snprintf(path, sizeof(path), "%s/class/power_supply", root);
+    mkdir(path, 0755);
+    add_supply(root, "battery0", "Battery", battery_attrs);
+    add_supply(root, "usb0", "USB", online);
+    for (int i = 0; i < GAMEPADS; ++i) {
+        char name[32];
+        snprintf(name, sizeof(name), "gamepad%i", i);
+        add_supply(root, name, "Battery", gamepad);
+    }
+
+    run(root);
+
+    nftw(root, remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+    printf("uevent_test: %s\n", failures ? "FAILED" : "ok");
+    return failures ? 1 : 0;
+}
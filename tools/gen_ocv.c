@@ -0,0 +1,152 @@
+/*
+ * Generates ocv_table.h: open circuit voltage of a cell at evenly spaced
+ * states of charge, for the fallback estimate in battery.c when a gauge has
+ * no capacity attribute.
+ *
+ * Each chemistry is given as a handful of (state of charge, OCV) points
+ * from typical discharge curves. They are resampled with a monotone cubic
+ * (Fritsch-Carlson), so the tables stay strictly increasing and battery.c
+ * only has to interpolate linearly between neighbours, in integers.
+ *
+ * usage: gen_ocv > ocv_table.h
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* table entries, one every 1000 / (OCV_POINTS - 1) permille */
+#define OCV_POINTS 21
+
+#define MAX_SOURCE_POINTS 16
+
+struct curve_point {
+    double soc; /* percent */
+    double mv;
+};
+
+struct chemistry {
+    const char* name;
+    const char* enum_name;
+    const char* comment;
+    struct curve_point points[MAX_SOURCE_POINTS];
+    int count;
+};
+
+static const struct chemistry chemistries[] = {
+    {
+        "liion",
+        "OCV_LIION",
+        "LiCoO2 and similar, charged to 4.2V",
+        {
+            { 0, 3300 }, { 5, 3560 }, { 10, 3680 }, { 20, 3740 }, { 30, 3770 }, { 40, 3790 },
+            { 50, 3820 }, { 60, 3870 }, { 70, 3920 }, { 80, 3980 }, { 90, 4060 }, { 100, 4200 },
+        },
+        12,
+    },
+    {
+        "lihv",
+        "OCV_LIHV",
+        "high voltage Li-ion and Li-polymer, charged to 4.35V",
+        {
+            { 0, 3350 }, { 5, 3600 }, { 10, 3700 }, { 20, 3770 }, { 30, 3810 }, { 40, 3850 },
+            { 50, 3900 }, { 60, 3970 }, { 70, 4040 }, { 80, 4120 }, { 90, 4210 }, { 100, 4350 },
+        },
+        12,
+    },
+    {
+        "lifepo4",
+        "OCV_LIFEPO4",
+        "LiFePO4, flat in the middle so only the ends are any good",
+        {
+            { 0, 2500 }, { 5, 2900 }, { 10, 3000 }, { 20, 3200 }, { 30, 3220 }, { 40, 3250 },
+            { 50, 3260 }, { 60, 3280 }, { 70, 3300 }, { 80, 3320 }, { 90, 3350 }, { 100, 3400 },
+        },
+        12,
+    },
+};
+
+#define CHEMISTRIES (int)(sizeof(chemistries) / sizeof(chemistries[0]))
+
+/* monotone cubic Hermite interpolation of the curve at soc */
+static double interpolate(const struct chemistry* c, double soc)
+{
+    const struct curve_point* p = c->points;
+    double slope[MAX_SOURCE_POINTS];
+    double tangent[MAX_SOURCE_POINTS];
+    int n = c->count;
+    int k;
+
+    for (k = 0; k < n - 1; ++k)
+        slope[k] = (p[k + 1].mv - p[k].mv) / (p[k + 1].soc - p[k].soc);
+
+    tangent[0] = slope[0];
+    tangent[n - 1] = slope[n - 2];
+    for (k = 1; k < n - 1; ++k)
+        tangent[k] = slope[k - 1] * slope[k] <= 0 ? 0 : (slope[k - 1] + slope[k]) / 2;
+
+    for (k = 0; k < n - 1; ++k) {
+        if (slope[k] == 0) {
+            tangent[k] = tangent[k + 1] = 0;
+            continue;
+        }
+        double a = tangent[k] / slope[k];
+        double b = tangent[k + 1] / slope[k];
+        double h = a * a + b * b;
+        if (h > 9) {
+            double t = 3 / sqrt(h);
+            tangent[k] = t * a * slope[k];
+            tangent[k + 1] = t * b * slope[k];
+        }
+    }
+
+    for (k = 0; k < n - 2 && soc > p[k + 1].soc; ++k)
+        ;
+
+    double h = p[k + 1].soc - p[k].soc;
+    double t = (soc - p[k].soc) / h;
+    double t2 = t * t;
+    double t3 = t2 * t;
+    return (2 * t3 - 3 * t2 + 1) * p[k].mv + (t3 - 2 * t2 + t) * h * tangent[k]
+        + (-2 * t3 + 3 * t2) * p[k + 1].mv + (t3 - t2) * h * tangent[k + 1];
+}
+
+int main(void)
+{
+    printf("/* generated by tools/gen_ocv, do not edit */\n\n");
+    printf("#include <stdint.h>\n\n");
+    printf("#define OCV_POINTS %i\n", OCV_POINTS);
+    printf("/* permille between table entries */\n");
+    printf("#define OCV_STEP %i\n\n", 1000 / (OCV_POINTS - 1));
+
+    printf("enum ocv_chemistry {\n");
+    for (int c = 0; c < CHEMISTRIES; ++c)
+        printf("\t%s, /* %s */\n", chemistries[c].enum_name, chemistries[c].comment);
+    printf("\tOCV_CHEMISTRIES,\n};\n\n");
+
+    printf("static const char *const ocv_chemistry_names[OCV_CHEMISTRIES] = {\n");
+    for (int c = 0; c < CHEMISTRIES; ++c)
+        printf("\t[%s] = \"%s\",\n", chemistries[c].enum_name, chemistries[c].name);
+    printf("};\n\n");
+
+    printf("/* open circuit voltage in mV at 0, OCV_STEP, 2 * OCV_STEP, ... permille */\n");
+    printf("static const uint16_t ocv_tables[OCV_CHEMISTRIES][OCV_POINTS] = {\n");
+    for (int c = 0; c < CHEMISTRIES; ++c) {
+        int last = 0;
+
+        printf("\t[%s] = {", chemistries[c].enum_name);
+        for (int i = 0; i < OCV_POINTS; ++i) {
+            int mv = (int)lround(interpolate(&chemistries[c], 100.0 * i / (OCV_POINTS - 1)));
+            if (mv <= last) {
+                fprintf(stderr, "%s: curve is not increasing at %i%%\n", chemistries[c].name,
+                    100 * i / (OCV_POINTS - 1));
+                return 1;
+            }
+            last = mv;
+            printf("%s%i,", i % 7 ? " " : "\n\t\t", mv);
+        }
+        printf("\n\t},\n");
+    }
+    printf("};\n");
+    return 0;
+}
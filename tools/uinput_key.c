@@ -0,0 +1,105 @@
+/*
+ * Press keys on a virtual input device, to try charging_sdl's key handling
+ * without the hardware:
+ *
+ *   uinput_key [-d ms] KEY...
+ *
+ * KEY is power, volumeup or volumedown. The device is created first and
+ * charging_sdl only opens devices at startup, so start it while this waits
+ * (-d, 3000 ms by default) before the first press.
+ */
+
+#include <fcntl.h>
+#include <linux/uinput.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <time.h>
+#include <unistd.h>
+
+/* ms between presses */
+#define PRESS_INTERVAL 500
+
+static const struct {
+    const char* name;
+    int code;
+} keys[] = {
+    { "power", KEY_POWER },
+    { "volumeup", KEY_VOLUMEUP },
+    { "volumedown", KEY_VOLUMEDOWN },
+};
+
+#define KEY_COUNT (sizeof(keys) / sizeof(keys[0]))
+
+static void sleep_ms(unsigned int ms)
+{
+    struct timespec ts = { ms / 1000, (ms % 1000) * 1000000L };
+    nanosleep(&ts, NULL);
+}
+
+static void emit(int fd, int type, int code, int value)
+{
+    struct input_event ev = { .type = type, .code = code, .value = value };
+    if (write(fd, &ev, sizeof(ev)) != sizeof(ev))
+        perror("write");
+}
+
+static int key_code(const char* name)
+{
+    for (size_t i = 0; i < KEY_COUNT; ++i) {
+        if (strcmp(keys[i].name, name) == 0)
+            return keys[i].code;
+    }
+    return -1;
+}
+
+int main(int argc, char** argv)
+{
+    unsigned int delay = 3000;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "d:")) != -1) {
+        if (opt != 'd') {
+            fprintf(stderr, "Usage: %s [-d ms] power|volumeup|volumedown...\n", argv[0]);
+            return 1;
+        }
+        delay = atoi(optarg);
+    }
+    for (int i = optind; i < argc; ++i) {
+        if (key_code(argv[i]) < 0) {
+            fprintf(stderr, "unknown key: %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    int fd = open("/dev/uinput", O_WRONLY | O_NONBLOCK);
+    if (fd < 0) {
+        perror("/dev/uinput");
+        return 1;
+    }
+
+    struct uinput_setup setup = { .id = { .bustype = BUS_VIRTUAL } };
+    snprintf(setup.name, sizeof(setup.name), "charge-mode test keys");
+    ioctl(fd, UI_SET_EVBIT, EV_KEY);
+    for (size_t i = 0; i < KEY_COUNT; ++i)
+        ioctl(fd, UI_SET_KEYBIT, keys[i].code);
+    if (ioctl(fd, UI_DEV_SETUP, &setup) < 0 || ioctl(fd, UI_DEV_CREATE) < 0) {
+        perror("uinput");
+        close(fd);
+        return 1;
+    }
+
+    sleep_ms(delay);
+    for (int i = optind; i < argc; ++i) {
+        emit(fd, EV_KEY, key_code(argv[i]), 1);
+        emit(fd, EV_SYN, SYN_REPORT, 0);
+        emit(fd, EV_KEY, key_code(argv[i]), 0);
+        emit(fd, EV_SYN, SYN_REPORT, 0);
+        sleep_ms(PRESS_INTERVAL);
+    }
+
+    ioctl(fd, UI_DEV_DESTROY);
+    close(fd);
+    return 0;
+}
@@ -0,0 +1,93 @@
+#include "uevent.h"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <linux/netlink.h>
+
+#include "log.h"
+
+#define UEVENT_KERNEL_GROUP 1
+#define UEVENT_RCVBUF (64 * 1024)
+
+int uevent_open(void)
+{
+    struct sockaddr_nl addr = {
+        .nl_family = AF_NETLINK,
+        .nl_groups = UEVENT_KERNEL_GROUP,
+    };
+    int rcvbuf = UEVENT_RCVBUF;
+
+    int fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
+        NETLINK_KOBJECT_UEVENT);
+    if (fd < 0) {
+        ERROR("can not open uevent socket: %s", strerror(errno));
+        return -1;
+    }
+
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        ERROR("can not bind uevent socket: %s", strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+int uevent_receive(int fd, char* buf, size_t buflen, struct uevent* ev)
+{
+    struct sockaddr_nl addr;
+    struct iovec iov = { .iov_base = buf, .iov_len = buflen - 1 };
+    struct msghdr msg = {
+        .msg_name = &addr,
+        .msg_namelen = sizeof(addr),
+        .msg_iov = &iov,
+        .msg_iovlen = 1,
+    };
+
+    ssize_t len = recvmsg(fd, &msg, 0);
+    if (len <= 0)
+        return -1;
+
+    /* only trust the kernel on netlink, other socket types carry no address */
+    if (msg.msg_namelen == sizeof(addr) && addr.nl_family == AF_NETLINK && addr.nl_pid != 0)
+        return 0;
+
+    buf[len] = '\0';
+
+    memset(ev, 0, sizeof(*ev));
+
+    /* header is "ACTION@DEVPATH", followed by NUL separated KEY=VALUE pairs */
+    char* at = strchr(buf, '@');
+    if (!at)
+        return 0;
+
+    size_t header_len = strlen(buf) + 1;
+    ev->payload = buf + header_len;
+    ev->payload_len = (size_t)len > header_len ? len - header_len : 0;
+
+    for (char* key = buf + header_len; key < buf + len; key += strlen(key) + 1) {
+        if (!strncmp(key, "ACTION=", 7))
+            ev->action = key + 7;
+        else if (!strncmp(key, "DEVPATH=", 8))
+            ev->devpath = key + 8;
+        else if (!strncmp(key, "SUBSYSTEM=", 10))
+            ev->subsystem = key + 10;
+        else if (!strncmp(key, "POWER_SUPPLY_NAME=", 18))
+            ev->name = key + 18;
+    }
+
+    if (!ev->action || !ev->subsystem)
+        return 0;
+
+    return strcmp(ev->subsystem, "power_supply") == 0 ? 1 : 0;
+}
+
+bool uevent_changes_nodes(const struct uevent* ev)
+{
+    return strcmp(ev->action, "add") == 0 || strcmp(ev->action, "remove") == 0;
+}
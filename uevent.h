@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* fields of a kernel uevent, pointing into the receive buffer */
+struct uevent {
+    const char* action; /* "add", "remove", "change", ... */
+    const char* devpath;
+    const char* subsystem;
+    const char* name; /* POWER_SUPPLY_NAME, NULL for other subsystems */
+    const char* payload; /* NUL separated KEY=VALUE list */
+    size_t payload_len;
+};
+
+/**
+  open a non-blocking NETLINK_KOBJECT_UEVENT socket subscribed to kernel events
+  @returns the socket or -1 on failure
+*/
+int uevent_open(void);
+
+/**
+  receive one uevent from fd and split it in place
+  any datagram socket works, so a socketpair can stand in for the kernel as in
+  test/uevent_test.c
+  @param fd the socket to read from
+  @param buf buffer the message is received into, the event points into it
+  @param buflen size of buf
+  @param ev the event to fill
+  @returns 1 for a power_supply event, 0 for an event of another subsystem,
+           -1 if nothing could be read
+*/
+int uevent_receive(int fd, char* buf, size_t buflen, struct uevent* ev);
+
+/**
+  check whether an event means power_supply nodes were added or removed
+  @param ev a power_supply event
+*/
+bool uevent_changes_nodes(const struct uevent* ev);